@@ -14,7 +14,6 @@ instruction *new_inst(char *inst,int len,int op_cnt,char **op,int *op_len)
   int j,k,mnemo_opcnt,omitted,skipped;
 #endif
   int i,inst_found=0;
-  hashdata data;
   instruction *new;
 
   new = mymalloc(sizeof(*new));
@@ -26,9 +25,7 @@ instruction *new_inst(char *inst,int len,int op_cnt,char **op,int *op_len)
   memset(ops,0,sizeof(ops));
 #endif
 
-  if (find_namelen_nc(mnemohash,inst,len,&data)) {
-    i = data.idx;
-
+  if ((i = find_mnemonic(inst,len,1)) >= 0) {
     /* try all mnemonics with the same name until operands match */
     do {
       inst_found = 1;
@@ -201,6 +198,30 @@ static size_t roffs_size(expr *offsexp,section *sec,taddr pc)
 }
 
 
+static int stable_size(atom *a)
+/* returns true, when the atom's size doesn't depend on its pc or on
+   any label, and it has nothing else to do while resolving */
+{
+  switch (a->type) {
+    case DATA:
+    case DATADEF:
+    case LINE:
+    case PRINTTEXT:
+    case PRINTEXPR:
+    case ASSERT:
+    case NLIST:
+      return 1;
+    case SPACE:
+      return a->content.sb->space_exp->type == NUM;
+#if HAVE_INSTRUCTION_FINAL
+    case INSTRUCTION:
+      return a->content.inst->code>=0 && instruction_final(a->content.inst);
+#endif
+  }
+  return 0;
+}
+
+
 /* adds an atom to the specified section; if sec==0, the current
    section is used */
 void add_atom(section *sec,atom *a)
@@ -214,6 +235,7 @@ void add_atom(section *sec,atom *a)
   }
 
   a->changes = 0;
+  a->flags = 0;
   a->src = cur_src;
   a->line = cur_src!=NULL ? cur_src->line : 0;
 
@@ -234,6 +256,8 @@ void add_atom(section *sec,atom *a)
   sec->pc = pcalign(a,sec->pc);
   a->lastsize = atom_size(a,sec,sec->pc);
   sec->pc += a->lastsize;
+  if (stable_size(a))
+    a->flags |= STABLE_SIZE;
   if (a->align > sec->align)
     sec->align = a->align;
 
@@ -414,6 +438,22 @@ void atom_printexpr(printexpr *pexp,section *sec,taddr pc)
 }
 
 
+static rlist *copy_relocs(rlist *rl)
+{
+  rlist *first,**rlp = &first;
+
+  for (; rl; rl=rl->next) {
+    *rlp = mymalloc(sizeof(rlist));
+    (*rlp)->type = rl->type;
+    (*rlp)->reloc = mymalloc(sizeof(nreloc));
+    memcpy((*rlp)->reloc,rl->reloc,sizeof(nreloc));
+    rlp = &(*rlp)->next;
+  }
+  *rlp = NULL;
+  return first;
+}
+
+
 atom *clone_atom(atom *a)
 {
   atom *new = mymalloc(sizeof(atom));
@@ -434,6 +474,32 @@ atom *clone_atom(atom *a)
       memcpy(p,a->content.defb,sizeof(defblock));
       new->content.defb = p;
       break;
+    /* DATA and SPACE may be released after writing a section, so they
+       need a copy */
+    case DATA:
+      {
+        dblock *db = new_dblock();
+
+        db->size = a->content.db->size;
+        if (db->size) {
+          db->data = mymalloc(db->size);
+          memcpy(db->data,a->content.db->data,db->size);
+        }
+        db->relocs = copy_relocs(a->content.db->relocs);
+        new->content.db = db;
+      }
+      break;
+    case SPACE:
+      {
+        sblock *sb = mymalloc(sizeof(sblock));
+
+        memcpy(sb,a->content.sb,sizeof(sblock));
+        sb->space_exp = copy_tree(sb->space_exp);
+        sb->fill_exp = copy_tree(sb->fill_exp);
+        sb->relocs = copy_relocs(sb->relocs);
+        new->content.sb = sb;
+      }
+      break;
     default:
       break;
   }
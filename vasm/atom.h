@@ -87,6 +87,7 @@ typedef struct atom {
   taddr align;
   size_t lastsize;
   unsigned changes;
+  unsigned flags;
   source *src;
   int line;
   listing *list;
@@ -109,6 +110,10 @@ typedef struct atom {
 
 #define MAXSIZECHANGES 5  /* warning, when atom changed size so many times */
 
+/* atom flags */
+#define STABLE_SIZE 1     /* size will never change, no need to resolve */
+#define CACHED_SIZE 2     /* size was loaded from the resolve cache */
+
 instruction *new_inst(char *inst,int len,int op_cnt,char **op,int *op_len);
 dblock *new_dblock();
 sblock *new_sblock(expr *,size_t,expr *);
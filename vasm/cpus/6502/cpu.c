@@ -181,16 +181,22 @@ static void optimize_instruction(instruction *ip,section *sec,
         if (find_base(op->value,&base,sec,pc) == BASE_OK) {
           if ((op->type==ABS || op->type==ABSX || op->type==ABSY)
               && base->sec!=NULL && (base->sec->flags & ABSOLUTE)
-              && (val>=0 && val<=0xff) && mnemo->ext.zp_opcode!=0) {
-            /* we can use a zero page addressing mode */
-            op->type += ZPAGE-ABS;
+              && mnemo->ext.zp_opcode!=0) {
+            if (val>=0 && val<=0xff) {
+              /* we can use a zero page addressing mode */
+              op->type += ZPAGE-ABS;
+            }
+            add_symrange(base,val-base->pc,0,0xff,0);
           }
           else if (op->type==REL && LOCREF(base) && base->sec==sec) {
             taddr bd = val - (pc + 2);
     
-            if ((bd<-0x80 || bd>0x7f) && branchopt) {
-              /* branch dest. out of range: use a B!cc/JMP combination */
-              op->type = RELJMP;
+            if (branchopt) {
+              if (bd<-0x80 || bd>0x7f) {
+                /* branch dest. out of range: use a B!cc/JMP combination */
+                op->type = RELJMP;
+              }
+              add_symrange(base,val-base->pc-2,-0x80,0x7f,1);
             }
           }
         }
@@ -543,7 +543,7 @@ static void create_mapping_symbol(int type,section *sec,taddr pc)
   if (type<TYPE_ARM || type>TYPE_DATA)
     ierror(0);
   if (elfoutput) {
-    sym = mymalloc(sizeof(symbol));
+    sym = alloc_symbol();
     sym->type = LABSYM;
     sym->flags = types[type];
     sym->name = names[type];
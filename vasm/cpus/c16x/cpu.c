@@ -408,6 +408,12 @@ static int translate(instruction *p,section *sec,taddr pc)
   if(c==JMP||(!notrans&&(c==JMPA||c==JMPR||c==JB||c==JNB))){
     val=reloffset(p->op[1]->offset,sec,pc);
     if(val<-256||val>254||val%2){
+      symbol *base;
+      /* the size only changes when a far target comes near */
+      if((val<-256||val>254)&&
+         find_base(p->op[1]->offset,&base,sec,pc)==BASE_OK&&
+         LOCREF(base)&&base->sec==sec)
+        add_symrange(base,val+pc-base->pc,-256,254,1);
       if(c==JB) return JNB|JMPCONV;
       if(c==JNB) return JB|JMPCONV;
       if(c==JMPA) return JMPA;
@@ -490,6 +490,12 @@ size_t instruction_size(instruction *ip, section *sec, taddr pc)
 }
 
 
+int instruction_final(instruction *ip)
+{
+  return 1;  /* size only depends on the opcode */
+}
+
+
 dblock *eval_instruction(instruction *ip, section *sec, taddr pc)
 {
   dblock *db = new_dblock();
@@ -18,6 +18,9 @@ extern int jag_big_endian;
 typedef int32_t taddr;
 typedef uint32_t utaddr;
 
+/* instruction sizes are known after parsing */
+#define HAVE_INSTRUCTION_FINAL 1
+
 /* minimum instruction alignment */
 #define INST_ALIGN 2
 
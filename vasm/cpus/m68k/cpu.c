@@ -4876,7 +4876,7 @@ int init_cpu()
     /* remove gas mnemonics from the hash table */
     for (i=0; i<mnemonic_cnt; i++) {
       if (mnemonics[i].ext.available & mgas) {
-        rem_hashentry(mnemohash,mnemonics[i].name,0);
+        rem_mnemonic(mnemonics[i].name);
         while (i+1<mnemonic_cnt &&
                !strcmp(mnemonics[i].name,mnemonics[i+1].name))
           i++;
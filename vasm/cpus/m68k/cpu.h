@@ -6,7 +6,6 @@
 #define BIGENDIAN 1
 #define LITTLEENDIAN 0
 #define VASM_CPU_M68K 1
-#define MNEMOHTABSIZE 0x4000
 
 /* maximum number of operands for one mnemonic */
 #define MAX_OPERANDS 6
@@ -711,6 +711,13 @@ size_t instruction_size(instruction *ip,section *sec,taddr pc)
 }
 
 
+int instruction_final(instruction *ip)
+/* Instructions only change their size with branch optimizations. */
+{
+  return !opt_branch;
+}
+
+
 dblock *eval_instruction(instruction *ip,section *sec,taddr pc)
 /* Convert an instruction into a DATA atom including relocations,
    when necessary. */
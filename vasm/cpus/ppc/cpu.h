@@ -7,7 +7,6 @@ extern int ppc_endianess;
 #define BIGENDIAN (ppc_endianess)
 #define LITTLEENDIAN (!ppc_endianess)
 #define VASM_CPU_PPC 1
-#define MNEMOHTABSIZE 0x18000
 
 /* maximum number of operands for one mnemonic */
 #define MAX_OPERANDS 5
@@ -19,6 +18,9 @@ extern int ppc_endianess;
 typedef int64_t taddr;
 typedef uint64_t utaddr;
 
+/* instructions are fixed size, unless branches are optimized */
+#define HAVE_INSTRUCTION_FINAL 1
+
 /* minimum instruction alignment */
 #define INST_ALIGN 4
 
@@ -260,6 +260,12 @@ dblock *eval_data(operand *op,size_t bitsize,section *sec,taddr pc)
 }                                     
 
 
+/* The size only depends on the operand types. */
+int instruction_final(instruction *p)
+{
+  return 1;
+}
+
 /* Calculate the size of the current instruction; must be identical
    to the data created by eval_instruction. */
 size_t instruction_size(instruction *p,section *sec,taddr pc)
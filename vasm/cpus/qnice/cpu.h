@@ -18,6 +18,9 @@ typedef uint32_t utaddr;
 #define BIGENDIAN 0
 #define VASM_CPU_QNICE 1
 
+/* instruction size only depends on the addressing modes */
+#define HAVE_INSTRUCTION_FINAL 1
+
 /* minimum instruction alignment */
 #define INST_ALIGN 2
 
@@ -139,9 +139,12 @@ static int opt_inst(instruction *p,section *sec,taddr pc)
   /* jmp->bra */
   if(p->code==6){
     expr *tree=p->op[0]->offset;
-    if(tree->type==SYM&&tree->c.sym->sec==sec&&LOCREF(tree->c.sym)&&
-       tree->c.sym->pc-pc>=-128&&tree->c.sym->pc-pc<=127)
-      return 7;
+    taddr val;
+    if(tree->type==SYM&&tree->c.sym->sec==sec&&LOCREF(tree->c.sym)){
+      eval_expr(tree,&val,sec,pc);
+      if(val-pc>=-128&&val-pc<=127)
+        return 7;
+    }
   }
   return p->code;
 }
@@ -1452,7 +1452,7 @@ char *parse_instruction(char *s,int *inst_len,char **ext,int *ext_len,
                         int *ext_cnt)
 /* parse instruction and save extension locations */
 {
-  hashdata data;
+  int idx;
   char *inst = s;
   int len;
 
@@ -1467,9 +1467,9 @@ char *parse_instruction(char *s,int *inst_len,char **ext,int *ext_len,
       s++;
     len = s - inst;
 
-    if (find_namelen(mnemohash,inst,len,&data)) {
+    if ((idx = find_mnemonic(inst,len,nocase)) >= 0) {
 #if 0  /*@@@ need a way to support prefixes at the same line with vasm */
-      mnemonic *mnemo = &mnemonics[data.idx];
+      mnemonic *mnemo = &mnemonics[idx];
 
       if (mnemo->ext.opcode_modifier & IsPrefix) {
         /* matched a prefix instruction, remember it and look for more */
@@ -25,6 +25,7 @@ struct err_out output_err_out[]={
 int output_errors=sizeof(output_err_out)/sizeof(output_err_out[0]);
 
 int errors;
+unsigned long messages;  /* errors, warnings and messages issued */
 int max_errors=5;
 int no_warn=0;
 
@@ -78,6 +79,7 @@ static void error(int n,va_list vl,struct err_out *errlist,int offset)
 
   if ((flags&DONTWARN) || ((flags&WARNING) && no_warn))
     return;
+  messages++;
 
   if ((flags&MESSAGE) && !(flags&(WARNING|ERROR|FATAL))) {
     f = stdout;  /* print messages to stdout */
@@ -5,6 +5,7 @@
 #define ERROR_H                                                                                
 
 extern int errors;
+extern unsigned long messages;
 extern int max_errors;
 extern int no_warn;
 
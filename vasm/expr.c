@@ -16,6 +16,72 @@ static int exp_type;
 
 static expr *expression();
 
+/* An expression tree is compiled into a postfix sequence of its nodes,
+   when it is evaluated for the first time. The nodes are still used for
+   their type and value, because cpu modules may change the type of an
+   operator node, e.g. into LOBYTE or HIBYTE. */
+struct exprprog {
+  int len;
+  int depth;  /* maximum number of values on the stack */
+  int type;   /* NUM, HUG or FLT, from the constants */
+  int nsyms;  /* number of symbol leaves */
+  expr *code[1];
+};
+
+#define EVALDEPTH 32
+
+/* The constness of each node is stored in nodecnst[] while evaluating,
+   starting at the frame base of the evaluation. The nodes of the last
+   evaluated program are kept, so find_base() can use them instead of
+   evaluating the subtrees again. */
+static char *nodecnst;
+static int nodetop,maxnodes;
+static struct exprprog *lastprog;
+static int lastbase;
+static section *lastsec;
+static taddr lastpc;
+static unsigned long lastlayout,lastdefine;
+
+static struct exprprog *compile_expr(expr *);
+static int prog_base(struct exprprog *,int,int,symbol **,section *,taddr);
+static int find_abs_base(expr *,symbol **);
+static int _find_base(expr *,symbol **,section *,taddr);
+
+/* Values of EXPRESSION symbols are remembered while resolving and
+   assembling. A value depending on labels is valid until a label moves,
+   otherwise until a symbol is redefined. */
+typedef struct symmemo {
+  expr *expr;           /* of the symbol, when evaluated */
+  unsigned long layout,define;  /* epochs of the evaluation */
+  taddr val;
+  int cnst;
+  int labelfree;
+  int nlabels;
+  symbol **labels;      /* referenced labels, for add_symdep() */
+} symmemo;
+
+unsigned long layout_epoch;  /* 0: no memoization */
+unsigned long define_epoch;
+static symmemo **memos;
+static size_t nmemos;
+static symbol **memolabels;  /* labels of the equates being evaluated */
+static size_t nmemolabels,maxmemolabels,memostart;
+static int memodepth;
+static int memovolatile;     /* value depends on section or pc */
+
+
+/* Expression nodes are allocated from a pool of fixed size chunks and
+   released nodes are kept in a free list, linked by their left pointer. */
+#define EXPRCHUNKSIZE 1024
+static expr *freeexprs;
+
+/* Constant leaves are hash-consed: number_expr() returns the same node
+   for the same value. Such a node is never changed or freed, and is
+   marked by &sharedleaf in its prog pointer, which leaves do not use. */
+static struct exprprog sharedleaf;
+static expr **numleaves;
+static size_t numleafsize,numleafcnt;
+
 
 static char *expskip(char *s)
 {
@@ -24,19 +90,40 @@ static char *expskip(char *s)
   return s;
 }
 
+static expr *alloc_expr(void)
+/* allocate an uninitialized node from the pool */
+{
+  expr *new;
+
+  if(freeexprs==NULL){
+    int i;
+
+    new=mymalloc(EXPRCHUNKSIZE*sizeof(expr));
+    for(i=0;i<EXPRCHUNKSIZE-1;i++)
+      new[i].left=&new[i+1];
+    new[i].left=NULL;
+    freeexprs=new;
+  }
+  new=freeexprs;
+  freeexprs=new->left;
+  return new;
+}
+
 expr *new_expr(void)
 {
-  expr *new=mymalloc(sizeof(*new));
+  expr *new=alloc_expr();
   new->left=new->right=0;
+  new->prog=NULL;
   return new;
 }
 
 expr *make_expr(int type,expr *left,expr *right)
 {
-  expr *new=mymalloc(sizeof(*new));
+  expr *new=alloc_expr();
   new->left=left;
   new->right=right;
   new->type=type;
+  new->prog=NULL;
   return new;
 }
 
@@ -45,6 +132,8 @@ expr *copy_tree(expr *old)
   expr *new=0;
 
   if(old){
+    if(old->prog==&sharedleaf)
+      return old;
     new=make_expr(old->type,copy_tree(old->left),copy_tree(old->right));
     new->c=old->c;
   }
@@ -57,7 +146,8 @@ expr *curpc_expr(void)
   if(!cpc){
     cpc=new_import(" *current pc dummy*");
     cpc->type=LABSYM;
-    cpc->flags|=VASMINTERN|PROTECTED;
+    cpc->flags|=VASMINTERN;
+    protect_symbol(cpc);
   }
   new->type=SYM;
   new->c.sym=cpc;
@@ -104,7 +194,6 @@ static expr *primary_expr(void)
       new->c.sym=sym;
     }else
       new=copy_tree(sym->expr);
-    myfree(name);
     return new;
   }
   m=const_prefix(s,&base);
@@ -171,7 +260,7 @@ static expr *primary_expr(void)
     case FLT:
       if(base!=10) goto hugeval;
       s=m;
-      flt=strtotfloat(s,&s);
+      flt=str2tfloat(s,&s);
       break;
     default:
       ierror(0);
@@ -179,9 +268,10 @@ static expr *primary_expr(void)
     }
     s=const_suffix(start,s);
     EXPSKIP();
+    if(exp_type==NUM)
+      return number_expr(val);
     new=new_expr();
     switch(new->type=exp_type){
-      case NUM: new->c.val=val; break;
       case HUG: new->c.huge=huge; break;
       case FLT: new->c.flt=flt; break;
     }
@@ -577,19 +667,42 @@ expr *parse_expr_float(char **pp)
 
 void free_expr(expr *tree)
 {
-  if(!tree)
+  if(!tree||tree->prog==&sharedleaf)
     return;
   free_expr(tree->left);
   free_expr(tree->right);
-  myfree(tree);
+  myfree(tree->prog);
+  tree->left=freeexprs;
+  freeexprs=tree;
 }
 
 /* Return type of expression.
    Either NUM, HUG or FLT. Labels or unknown symbols default to NUM.
    Returns 0 in case of an error (e.g. epxression is NULL pointer). */
+static int type_of_prog(expr *tree)
+/* the highest type of all leaves */
+{
+  struct exprprog *prog;
+  int type,i,n;
+
+  if(tree->prog==NULL)
+    tree->prog=compile_expr(tree);
+  prog=tree->prog;
+  type=prog->type;
+  for(i=0,n=prog->nsyms;n>0;i++){
+    if(prog->code[i]->type==SYM){
+      int stype=type_of_expr(prog->code[i]);
+      if(stype>type)
+        type=stype;
+      n--;
+    }
+  }
+  return type;
+}
+
 int type_of_expr(expr *tree)
 {
-  int ltype,rtype;
+  int ltype;
   if(tree==NULL)
     return 0;
   ltype=tree->type;
@@ -602,9 +715,7 @@ int type_of_expr(expr *tree)
     return ltype;
   }else if(ltype==NUM||ltype==HUG||ltype==FLT)
     return ltype;
-  ltype=type_of_expr(tree->left);
-  rtype=type_of_expr(tree->right);
-  return rtype>ltype?rtype:ltype;
+  return type_of_prog(tree);
 }
 
 /* Try to evaluate expression as far as possible. Subexpressions
@@ -615,8 +726,13 @@ void simplify_expr(expr *tree)
   thuge hval;
   tfloat fval;
   int type=0;
-  if(!tree)
+  if(!tree||tree->prog==&sharedleaf)
     return;
+  if(tree->prog){
+    /* tree may change */
+    myfree(tree->prog);
+    tree->prog=NULL;
+  }
   simplify_expr(tree->left);
   simplify_expr(tree->right);
   if(tree->type==SUB&&tree->right->type==SYM&&tree->left->type==SUB&&
@@ -920,31 +1036,274 @@ void simplify_expr(expr *tree)
   }
 }
 
-/* Evaluate an expression using current values of all symbols.
-   Result is written to *result. The return value specifies
-   whether the result is constant (i.e. only depending on
-   constants or absolute symbols). */
-int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
+static int count_nodes(expr *tree,int *depth)
 {
-  taddr val,lval,rval;
-  symbol *lsym,*rsym;
+  int n,ld,rd;
+
+  if(tree->left==NULL){
+    *depth=1;
+    return 1;
+  }
+  n=count_nodes(tree->left,&ld)+1;
+  if(tree->right){
+    n+=count_nodes(tree->right,&rd);
+    if(rd+1>ld)
+      ld=rd+1;
+  }
+  *depth=ld;
+  return n;
+}
+
+static expr **emit_nodes(expr **code,expr *tree)
+{
+  if(tree->left){
+    code=emit_nodes(code,tree->left);
+    if(tree->right)
+      code=emit_nodes(code,tree->right);
+  }
+  *code++=tree;
+  return code;
+}
+
+static struct exprprog *compile_expr(expr *tree)
+{
+  struct exprprog *prog;
+  int n,depth;
+
+  n=count_nodes(tree,&depth);
+  prog=mymalloc(sizeof(struct exprprog)+(n-1)*sizeof(expr *));
+  prog->len=n;
+  prog->depth=depth;
+  prog->type=NUM;
+  prog->nsyms=0;
+  emit_nodes(prog->code,tree);
+  if(prog==lastprog)
+    lastprog=NULL;  /* reused memory of a freed program */
+  while(n--){
+    tree=prog->code[n];
+    if(tree->type==SYM)
+      prog->nsyms++;
+    else if((tree->type==HUG||tree->type==FLT)&&tree->type>prog->type)
+      prog->type=tree->type;
+  }
+  return prog;
+}
+
+/* index of the left operand of binary node i, skipping the right one */
+static int left_operand(struct exprprog *prog,int i)
+{
+  expr *p;
+  int n;
+
+  for(i--,n=1;n>0;i--){
+    p=prog->code[i];
+    n--;
+    if(p->left)
+      n+=p->right?2:1;
+  }
+  return i;
+}
+
+static void memo_label(symbol *sym)
+{
+  size_t i;
+
+  if(sym==cpc){
+    memovolatile=1;
+    return;
+  }
+  for(i=memostart;i<nmemolabels;i++){
+    if(memolabels[i]==sym)
+      return;
+  }
+  if(nmemolabels>=maxmemolabels){
+    maxmemolabels=maxmemolabels?2*maxmemolabels:16;
+    memolabels=myrealloc(memolabels,maxmemolabels*sizeof(symbol *));
+  }
+  memolabels[nmemolabels++]=sym;
+}
+
+static int eval_memo(symbol *sym,taddr *result,section *sec,taddr pc)
+{
+  symmemo *m;
+  unsigned long msgs;
+  size_t start,outer,i;
+  int cnst,vol;
+
+  if(sym->handle>=nmemos){
+    size_t n=nmemos?nmemos:1024;
+    while(n<=sym->handle)
+      n*=2;
+    memos=myrealloc(memos,n*sizeof(symmemo *));
+    memset(memos+nmemos,0,(n-nmemos)*sizeof(symmemo *));
+    nmemos=n;
+  }
+  if(!(m=memos[sym->handle])){
+    m=memos[sym->handle]=mymalloc(sizeof(symmemo));
+    m->expr=NULL;
+    m->labels=NULL;
+  }
+  else if(m->expr==sym->expr&&m->define==define_epoch&&
+          (m->labelfree||m->layout==layout_epoch)){
+    for(i=0;i<m->nlabels;i++){
+      if(record_symdeps)
+        add_symdep(m->labels[i]);
+      if(memodepth)
+        memo_label(m->labels[i]);
+    }
+    *result=m->val;
+    return m->cnst;
+  }
+
+  if(sym->flags&INEVAL)
+    general_error(18,sym->name);
+  sym->flags|=INEVAL;
+  start=nmemolabels;
+  outer=memostart;
+  memostart=start;
+  vol=memovolatile;
+  memovolatile=0;
+  msgs=messages;
+  memodepth++;
+  cnst=eval_expr(sym->expr,result,sec,pc);
+  memodepth--;
+  memostart=outer;
+  sym->flags&=~INEVAL;
+
+  if(!memovolatile&&messages==msgs){
+    m->expr=sym->expr;
+    m->val=*result;
+    m->cnst=cnst;
+    m->nlabels=nmemolabels-start;
+    m->labelfree=m->nlabels==0;
+    m->layout=layout_epoch;
+    m->define=define_epoch;
+    myfree(m->labels);
+    m->labels=NULL;
+    if(m->nlabels){
+      m->labels=mymalloc(m->nlabels*sizeof(symbol *));
+      memcpy(m->labels,memolabels+start,m->nlabels*sizeof(symbol *));
+    }
+  }
+  else
+    m->expr=NULL;
+  memovolatile|=vol;
+  if(!memodepth)
+    nmemolabels=0;
+  return cnst;
+}
+
+/* start or stop remembering the values of EXPRESSION symbols */
+void memo_exprs(int on)
+{
+  size_t i;
+
+  for(i=0;i<nmemos;i++){
+    if(memos[i]){
+      myfree(memos[i]->labels);
+      myfree(memos[i]);
+    }
+  }
+  myfree(memos);
+  memos=NULL;
+  nmemos=0;
+  layout_epoch=define_epoch=on?1:0;
+}
+
+/* evaluate a leaf of the tree: a constant or a symbol */
+static int eval_leaf(expr *tree,taddr *result,section *sec,taddr pc)
+{
+  taddr val;
   int cnst=1;
 
-  if(!tree)
+  switch(tree->type){
+  case SYM:
+    if(tree->c.sym->type==EXPRESSION){
+      if(layout_epoch)
+        return eval_memo(tree->c.sym,result,sec,pc);
+      if(tree->c.sym->flags&INEVAL)
+        general_error(18,tree->c.sym->name);
+      tree->c.sym->flags|=INEVAL;
+      cnst=eval_expr(tree->c.sym->expr,&val,sec,pc);
+      tree->c.sym->flags&=~INEVAL;
+    }else if(LOCREF(tree->c.sym)){
+      update_curpc(tree,sec,pc);
+      val=tree->c.sym->pc;
+      if(record_symdeps)
+        add_symdep(tree->c.sym!=cpc?tree->c.sym:NULL);
+      if(memodepth)
+        memo_label(tree->c.sym);
+      cnst=tree->c.sym->sec==NULL?0:(tree->c.sym->sec->flags&UNALLOCATED)!=0;
+    }else{
+      /* IMPORT */
+      cnst=0;
+      val=0;
+    }
+    break;
+  case NUM:
+    val=tree->c.val;
+    break;
+  case HUG:
+    if (!huge_chkrange(tree->c.huge,bytespertaddr*8))
+      general_error(21,bytespertaddr*8);  /* target data type overflow */
+    val=huge_to_int(tree->c.huge);
+    break;
+  case FLT:
+    if (!flt_chkrange(tree->c.flt,bytespertaddr*8))
+      general_error(21,bytespertaddr*8);  /* target data type overflow */
+    val=(taddr)tree->c.flt;
+    break;
+  default:
     ierror(0);
-  if(tree->left&&!eval_expr(tree->left,&lval,sec,pc))
-    cnst=0;
-  if(tree->right&&!eval_expr(tree->right,&rval,sec,pc))
-    cnst=0;
+  }
+  *result=val;
+  return cnst;
+}
+
+/* base symbol of operand i, like find_base() returns it */
+static symbol *operand_base(expr *p,struct exprprog *prog,int base,int i,
+                            section *sec,taddr pc)
+{
+  symbol *sym;
+
+  if(p->left==NULL){
+    if(p->type!=SYM)
+      return NULL;
+    if(p->c.sym->type!=EXPRESSION)
+      return p->c.sym;
+  }
+  prog_base(prog,base,i,&sym,sec,pc);
+  return sym;
+}
+
+/* apply the operator of node i to the values of its operands */
+static int eval_op(struct exprprog *prog,int base,int i,taddr lval,
+                   taddr rval,int cnst,taddr *result,section *sec,taddr pc)
+{
+  expr *tree=prog->code[i];
+  taddr val;
+  symbol *lsym,*rsym;
 
   switch(tree->type){
   case ADD:
     val=(lval+rval);
     break;
   case SUB:
-    find_base(tree->left,&lsym,sec,pc);
-    find_base(tree->right,&rsym,sec,pc);
-    if(cnst==0&&lsym!=NULL&&rsym!=NULL&&LOCREF(rsym)){
+    if(cnst){
+#ifdef EXT_FIND_BASE
+      /* the cpu module may rewrite operators when looking for a base */
+      if(tree->left->left)
+        prog_base(prog,base,left_operand(prog,i),&lsym,sec,pc);
+      if(tree->right->left)
+        prog_base(prog,base,i-1,&rsym,sec,pc);
+#endif
+      val=(lval-rval);
+      break;
+    }
+    memovolatile=1;  /* result may depend on sec and pc */
+    lsym=operand_base(tree->left,prog,base,left_operand(prog,i),sec,pc);
+    rsym=operand_base(tree->right,prog,base,i-1,sec,pc);
+    if(lsym!=NULL&&rsym!=NULL&&LOCREF(rsym)){
       if(LOCREF(lsym)&&lsym->sec==rsym->sec){
         /* l2-l1 is constant when both have a valid symbol-base, and both
            symbols are LABSYMs from the same section, e.g. (sym1+x)-(sym2-y) */
@@ -1032,36 +1391,6 @@ int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
   case EQ:
     val=BOOLEAN(lval==rval);
     break;
-  case SYM:
-    if(tree->c.sym->type==EXPRESSION){
-      if(tree->c.sym->flags&INEVAL)
-        general_error(18,tree->c.sym->name);
-      tree->c.sym->flags|=INEVAL;
-      cnst=eval_expr(tree->c.sym->expr,&val,sec,pc);
-      tree->c.sym->flags&=~INEVAL;
-    }else if(LOCREF(tree->c.sym)){
-      update_curpc(tree,sec,pc);
-      val=tree->c.sym->pc;
-      cnst=tree->c.sym->sec==NULL?0:(tree->c.sym->sec->flags&UNALLOCATED)!=0;
-    }else{
-      /* IMPORT */
-      cnst=0;
-      val=0;
-    }
-    break;
-  case NUM:
-    val=tree->c.val;
-    break;
-  case HUG:
-    if (!huge_chkrange(tree->c.huge,bytespertaddr*8))
-      general_error(21,bytespertaddr*8);  /* target data type overflow */
-    val=huge_to_int(tree->c.huge);
-    break;
-  case FLT:
-    if (!flt_chkrange(tree->c.flt,bytespertaddr*8))
-      general_error(21,bytespertaddr*8);  /* target data type overflow */
-    val=(taddr)tree->c.flt;
-    break;
   default:
 #ifdef EXT_UNARY_EVAL
     if (EXT_UNARY_EVAL(tree->type,lval,&val,cnst))
@@ -1073,6 +1402,70 @@ int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
   return cnst;
 }
 
+/* Evaluate an expression using current values of all symbols.
+   Result is written to *result. The return value specifies
+   whether the result is constant (i.e. only depending on
+   constants or absolute symbols). */
+int eval_expr(expr *tree,taddr *result,section *sec,taddr pc)
+{
+  taddr vstack[EVALDEPTH],*val;
+  int cstack[EVALDEPTH],*cnst;
+  struct exprprog *prog;
+  expr *p;
+  int i,sp,base;
+
+  if(!tree)
+    ierror(0);
+  if(tree->left==NULL)
+    return eval_leaf(tree,result,sec,pc);
+  if(tree->prog==NULL)
+    tree->prog=compile_expr(tree);
+  prog=tree->prog;
+
+  base=nodetop;
+  nodetop+=prog->len;
+  if(nodetop>maxnodes){
+    maxnodes=nodetop*2;
+    nodecnst=myrealloc(nodecnst,maxnodes);
+  }
+
+  if(prog->depth>EVALDEPTH){
+    val=mymalloc(prog->depth*sizeof(taddr));
+    cnst=mymalloc(prog->depth*sizeof(int));
+  }else{
+    val=vstack;
+    cnst=cstack;
+  }
+  for(i=0,sp=-1;i<prog->len;i++){
+    p=prog->code[i];
+    if(p->left==NULL){
+      sp++;
+      cnst[sp]=eval_leaf(p,&val[sp],sec,pc);
+    }else if(p->right==NULL){
+      cnst[sp]=eval_op(prog,base,i,val[sp],0,cnst[sp],&val[sp],sec,pc);
+    }else{
+      sp--;
+      cnst[sp]=eval_op(prog,base,i,val[sp],val[sp+1],cnst[sp]&&cnst[sp+1],
+                       &val[sp],sec,pc);
+    }
+    nodecnst[base+i]=cnst[sp];
+  }
+  nodetop=base;
+  lastprog=prog;
+  lastbase=base;
+  lastsec=sec;
+  lastpc=pc;
+  lastlayout=layout_epoch;
+  lastdefine=define_epoch;
+  *result=val[0];
+  i=cnst[0];
+  if(val!=vstack){
+    myfree(val);
+    myfree(cnst);
+  }
+  return i;
+}
+
 /* Evaluate a huge integer expression using current values of all symbols.
    Result is written to *result. The return value specifies whether all
    operations were valid. */
@@ -1377,13 +1770,75 @@ static int _find_base(expr *p,symbol **base,section *sec,taddr pc)
   return BASE_ILLEGAL;
 }
 
+/* _find_base() for node i of a program, using the constness of the
+   operands from its evaluation at frame fb */
+static int rel_base(struct exprprog *prog,int fb,int i,symbol **base,
+                    section *sec,taddr pc)
+{
+  expr *p=prog->code[i];
+  int l;
+
+  if(p->left==NULL)
+    return _find_base(p,base,sec,pc);
+  if(p->type==ADD){
+    l=left_operand(prog,i);
+    if(nodecnst[fb+l]&&rel_base(prog,fb,i-1,base,sec,pc)==BASE_OK)
+      return BASE_OK;
+    if(nodecnst[fb+i-1]&&rel_base(prog,fb,l,base,sec,pc)==BASE_OK)
+      return BASE_OK;
+  }
+  if(p->type==SUB){
+    symbol *pcsym;
+    l=left_operand(prog,i);
+    if(nodecnst[fb+i-1]&&rel_base(prog,fb,l,base,sec,pc)==BASE_OK)
+      return BASE_OK;
+    if(rel_base(prog,fb,l,base,sec,pc)==BASE_OK&&
+       rel_base(prog,fb,i-1,&pcsym,sec,pc)==BASE_OK) {
+      if(LOCREF(pcsym)&&pcsym->sec==sec&&(LOCREF(*base)||EXTREF(*base)))
+        return BASE_PCREL;
+    }
+  }
+  return BASE_ILLEGAL;
+}
+
+/* find_base() for node i of a program, evaluated at frame fb */
+static int prog_base(struct exprprog *prog,int fb,int i,symbol **base,
+                     section *sec,taddr pc)
+{
+#ifdef EXT_FIND_BASE
+  int ret;
+  if(ret=EXT_FIND_BASE(base,prog->code[i],sec,pc))
+    return ret;
+#endif
+  if(base){
+    *base=NULL;
+    if(find_abs_base(prog->code[i],base)){
+      if(*base!=NULL)
+        return EXTREF(*base)?BASE_ILLEGAL:BASE_OK;
+      return BASE_NONE;
+    }
+  }
+  return rel_base(prog,fb,i,base,sec,pc);
+}
+
 /* Tests, if an expression is based only on one non-absolute
    symbol plus constants. Returns that symbol or zero.
    Note: Does not find all possible solutions. */
 int find_base(expr *p,symbol **base,section *sec,taddr pc)
 {
-#ifdef EXT_FIND_BASE
   int ret;
+
+  if(p->prog!=NULL&&p->prog==lastprog&&lastbase>=nodetop&&
+     lastsec==sec&&lastpc==pc&&layout_epoch!=0&&
+     lastlayout==layout_epoch&&lastdefine==define_epoch){
+    /* use the nodes of the preceding eval_expr() */
+    int top=nodetop;
+    nodetop=lastbase+lastprog->len;
+    ret=prog_base(lastprog,lastbase,lastprog->len-1,base,sec,pc);
+    nodetop=top;
+    return ret;
+  }
+#ifdef EXT_FIND_BASE
   if(ret=EXT_FIND_BASE(base,p,sec,pc))
     return ret;
 #endif
@@ -1399,11 +1854,50 @@ int find_base(expr *p,symbol **base,section *sec,taddr pc)
   return _find_base(p,base,sec,pc);
 }
 
+static size_t hash_num(taddr val)
+{
+  utaddr h=(utaddr)val;
+
+  h^=h>>17;
+  h*=0x9e3779b1;
+  return (size_t)(h^(h>>15));
+}
+
 expr *number_expr(taddr val)
 {
-  expr *new=new_expr();
+  size_t i,mask;
+  expr *new;
+
+  if(numleafcnt*4>=numleafsize*3){
+    /* grow and rehash the table of shared constants */
+    expr **old=numleaves;
+    size_t oldsize=numleafsize;
+
+    numleafsize=oldsize?oldsize*2:1024;
+    numleaves=mycalloc(numleafsize*sizeof(expr *));
+    mask=numleafsize-1;
+    for(i=0;i<oldsize;i++){
+      if(new=old[i]){
+        size_t j=hash_num(new->c.val)&mask;
+        while(numleaves[j])
+          j=(j+1)&mask;
+        numleaves[j]=new;
+      }
+    }
+    myfree(old);
+  }
+  mask=numleafsize-1;
+  for(i=hash_num(val)&mask;new=numleaves[i];i=(i+1)&mask){
+    if(new->c.val==val)
+      return new;
+  }
+  new=alloc_expr();
   new->type=NUM;
+  new->left=new->right=NULL;
   new->c.val=val;
+  new->prog=&sharedleaf;
+  numleaves[i]=new;
+  numleafcnt++;
   return new;
 }
 
@@ -19,6 +19,7 @@ struct expr {
     thuge huge;
     symbol *sym;
   } c;
+  struct exprprog *prog;  /* postfix program, made by first eval_expr() */
 };
 
 /* Macros for extending the unary operation types (e.g. '<' and '>' for 6502).
@@ -33,6 +34,7 @@ struct expr {
 /* global variables */
 extern char current_pc_char;
 extern int unsigned_shift;
+extern unsigned long layout_epoch,define_epoch;
 
 /* functions */
 expr *new_expr(void);
@@ -44,7 +46,7 @@ expr *parse_expr_tmplab(char **);
 expr *parse_expr_huge(char **);
 expr *parse_expr_float(char **);
 taddr parse_constexpr(char **);
-expr *number_expr(taddr);
+expr *number_expr(taddr);  /* shared node, must not be modified */
 expr *huge_expr(thuge);
 expr *float_expr(tfloat);
 void free_expr(expr *);
@@ -54,6 +56,7 @@ int eval_expr(expr *,taddr *,section *,taddr);
 int eval_expr_huge(expr *,thuge *);
 int eval_expr_float(expr *,tfloat *);
 void print_expr(FILE *,expr *);
+void memo_exprs(int);
 int find_base(expr *,symbol **,section *,taddr);
 
 /* find_base return codes */
@@ -72,3 +72,4 @@
   "cannot mix positional and keyword arguments",ERROR,
   "undefined macro argument name",ERROR,
   "required macro argument %d was left out",ERROR,
+  "could not write resolve cache <%s>",NOLINE|WARNING,
@@ -13,6 +13,24 @@
 
 typedef uint32_t digit;
 
+/* Compilers with a native 128-bit integer type use it for the arithmetic.
+   Define NO_INT128 to test the portable implementation. */
+#if defined(__SIZEOF_INT128__) && !defined(NO_INT128)
+#define NATIVE128
+typedef unsigned __int128 u128;
+typedef __int128 s128;
+#define TO128(h) (((u128)(h).hi << 64) | (h).lo)
+
+static thuge from128(u128 v)
+{
+  thuge r;
+
+  r.hi = (uint64_t)(v >> 64);
+  r.lo = (uint64_t)v;
+  return r;
+}
+#endif
+
 
 thuge huge_zero(void)
 {
@@ -208,6 +226,9 @@ thuge hxor(thuge a,thuge b)
 
 thuge haddi(thuge a,int64_t b)
 {
+#ifdef NATIVE128
+  return from128(TO128(a) + (u128)(s128)b);
+#else
   thuge r;
 
   r.lo = a.lo + (uint64_t)b;
@@ -216,42 +237,52 @@ thuge haddi(thuge a,int64_t b)
   else
     r.hi = (r.lo<a.lo) ? a.hi+1 : a.hi;
   return r;
+#endif
 }
 
 
 thuge hadd(thuge a,thuge b)
 {
+#ifdef NATIVE128
+  return from128(TO128(a) + TO128(b));
+#else
   thuge r;
 
   r.lo = a.lo + b.lo;
-  if (HUGESIGN(b))
-    r.hi = (r.lo>a.lo) ? a.hi + b.hi - 1 : a.hi + b.hi;
-  else
-    r.hi = (r.lo<a.lo) ? a.hi + b.hi + 1 : a.hi + b.hi;
+  r.hi = (r.lo<a.lo) ? a.hi + b.hi + 1 : a.hi + b.hi;
   return r;
+#endif
 }
 
 
 thuge hsub(thuge a,thuge b)
 {
+#ifdef NATIVE128
+  return from128(TO128(a) - TO128(b));
+#else
   thuge r;
 
   r.lo = a.lo - b.lo;
-  if (HUGESIGN(b))
-    r.hi = (r.lo<a.lo) ? a.hi - b.hi + 1 : a.hi - b.hi;
-  else
-    r.hi = (r.lo>a.lo) ? a.hi - b.hi - 1 : a.hi - b.hi;
+  r.hi = (a.lo<b.lo) ? a.hi - b.hi - 1 : a.hi - b.hi;
   return r;
+#endif
 }
 
 
+/* signed comparison */
 int hcmp(thuge a,thuge b)
 {
-  thuge c = hsub(a,b);
-
-  if (c.hi == 0 && c.lo == 0)
-    return 0;
-  return HUGESIGN(c) ? -1 : 1;
+#ifdef NATIVE128
+  s128 x = (s128)TO128(a), y = (s128)TO128(b);
+
+  return x<y ? -1 : (x>y ? 1 : 0);
+#else
+  if (a.hi != b.hi)
+    return (int64_t)a.hi < (int64_t)b.hi ? -1 : 1;
+  if (a.lo != b.lo)
+    return a.lo < b.lo ? -1 : 1;
+  return 0;
+#endif
 }
 
 
@@ -259,6 +290,13 @@ thuge hshra(thuge a,int b)
 {
   thuge r;
 
+  if (b >= HUGEBITS) {
+    r.hi = r.lo = HUGESIGN(a) ? ~0 : 0;
+    return r;
+  }
+#ifdef NATIVE128
+  return from128((u128)((s128)TO128(a) >> b));
+#else
   if (b >= HUGEBITS/2) {
     r.hi = HUGESIGN(a) ? ~0 : 0;
     r.lo = (int64_t)a.hi >> (b - HUGEBITS/2);
@@ -272,13 +310,21 @@ thuge hshra(thuge a,int b)
     r.lo = (a.hi << (HUGEBITS/2 - b)) | (a.lo >> b);
   }
   return r;
+#endif
 }
 
 
 thuge hshr(thuge a,int b)
 {
+#ifdef NATIVE128
+  if (b >= HUGEBITS)
+    return huge_zero();
+  return from128(TO128(a) >> b);
+#else
   thuge r;
 
+  if (b >= HUGEBITS)
+    return huge_zero();
   if (b >= HUGEBITS/2) {
     r.hi = 0;
     r.lo = a.hi >> (b - HUGEBITS/2);
@@ -292,13 +338,21 @@ thuge hshr(thuge a,int b)
     r.lo = (a.hi << (HUGEBITS/2 - b)) | (a.lo >> b);
   }
   return r;
+#endif
 }
 
 
 thuge hshl(thuge a,int b)
 {
+#ifdef NATIVE128
+  if (b >= HUGEBITS)
+    return huge_zero();
+  return from128(TO128(a) << b);
+#else
   thuge r;
 
+  if (b >= HUGEBITS)
+    return huge_zero();
   if (b >= HUGEBITS/2) {
     r.hi = a.lo << (b - HUGEBITS/2);
     r.lo = 0;
@@ -312,50 +366,51 @@ thuge hshl(thuge a,int b)
     r.lo = a.lo << b;
   }
   return r;
+#endif
 }
 
 
-thuge hmuli(thuge a,int64_t b)
+#ifndef NATIVE128
+/* full 128-bit product of two 64-bit values */
+static thuge mul64(uint64_t a,uint64_t b)
 {
-  uint64_t tmp1,tmp2,carry,ub;
+  uint64_t t,m1,m2;
   thuge r;
 
-  ub = (uint64_t)b;
-  r.lo = a.lo * ub;
-  r.hi = a.hi * ub;
-  tmp1 = HIHALF(a.lo) * LOHALF(ub);
-  carry = tmp1 + LOHALF(a.lo) * HIHALF(ub);
-  if (carry < tmp1)
-    r.hi += BASE;
-  r.hi += HIHALF(carry);
-  tmp1 = HIHALF(a.lo) * HIHALF(ub);
-  r.hi += tmp1;
-  if (tmp1 + (carry << HALF_BITS) < tmp1)
-    r.hi++;
+  t = LOHALF(a) * LOHALF(b);
+  m1 = HIHALF(a) * LOHALF(b) + HIHALF(t);
+  m2 = LOHALF(a) * HIHALF(b) + LOHALF(m1);
+  r.hi = HIHALF(a) * HIHALF(b) + HIHALF(m1) + HIHALF(m2);
+  r.lo = (m2 << HALF_BITS) | LOHALF(t);
   return r;
 }
+#endif
+
+
+thuge hmuli(thuge a,int64_t b)
+{
+#ifdef NATIVE128
+  return from128(TO128(a) * (u128)(s128)b);
+#else
+  return hmul(a,huge_from_int(b));
+#endif
+}
 
 
 thuge hmul(thuge a,thuge b)
 {
-  uint64_t tmp1,tmp2,carry;
-  thuge r;
+#ifdef NATIVE128
+  return from128(TO128(a) * TO128(b));
+#else
+  thuge r = mul64(a.lo,b.lo);
 
-  r.lo = a.lo * b.lo;
-  r.hi = a.hi * b.lo + b.hi * a.lo;
-  tmp1 = HIHALF(a.lo) * LOHALF(b.lo);
-  carry = tmp1 + LOHALF(a.lo) * HIHALF(b.lo);
-  if (carry < tmp1)
-    r.hi += BASE;
-  r.hi += HIHALF(carry);
-  tmp1 = HIHALF(a.lo) * HIHALF(b.lo);
-  r.hi += tmp1;
-  if (tmp1 + (carry << HALF_BITS) < tmp1)
-    r.hi++;
+  r.hi += a.hi * b.lo + a.lo * b.hi;
   return r;
+#endif
 }
 
 
+#ifndef NATIVE128
 static void shift_digits(digit *p,int len,int sh)
 {
   int i;
@@ -471,7 +526,7 @@ qhat_too_big:
     if (HIHALF(t)) {
       qhat--;
       for (t=0, i=n; i>0; i--) {
-        t += u[i+j] + v[i];
+        t += (uint64_t)u[i+j] + v[i];
         u[i+j] = (digit)LOHALF(t);
         t = HIHALF(t);
       }
@@ -498,8 +553,27 @@ qhat_too_big:
 }
 
 
+#endif /* !NATIVE128 */
+
+
 thuge hdiv(thuge a,thuge b)
 {
+#ifdef NATIVE128
+  u128 x = TO128(a), y = TO128(b);
+  int neg = 0;
+
+  if (y == 0)
+    ierror(0);  /* division by zero */
+  if (HUGESIGN(a)) {
+    neg ^= 1;
+    x = -x;
+  }
+  if (HUGESIGN(b)) {
+    neg ^= 1;
+    y = -y;
+  }
+  return from128(neg ? -(x/y) : x/y);
+#else
   int neg = 0;
   thuge r;
 
@@ -513,22 +587,34 @@ thuge hdiv(thuge a,thuge b)
   }
   r = divmod(a,b,NULL);
   return neg ? hneg(r) : r;
+#endif
 }
 
 
+/* the remainder has the sign of the dividend, like in C */
 thuge hmod(thuge a,thuge b)
 {
+#ifdef NATIVE128
+  u128 x = TO128(a), y = TO128(b);
+
+  if (y == 0)
+    ierror(0);  /* division by zero */
+  if (HUGESIGN(b))
+    y = -y;
+  if (HUGESIGN(a))
+    return from128(-(-x % y));
+  return from128(x % y);
+#else
   int neg = 0;
   thuge r;
 
   if (HUGESIGN(a)) {
-    neg ^= 1;
+    neg = 1;
     a = hneg(a);
   }
-  if (HUGESIGN(b)) {
-    neg ^= 1;
+  if (HUGESIGN(b))
     b = hneg(b);
-  }
   (void)divmod(a,b,&r);
   return neg ? hneg(r) : r;
+#endif
 }
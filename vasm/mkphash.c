@@ -0,0 +1,295 @@
+/*
+ * mkphash
+ * Generates the perfect hash table for a cpu's mnemonics[] from its
+ * opcodes.h. Without an argument, or when the file does not exist, an
+ * empty table is written, which makes vasm fall back to a dynamic hash
+ * table. The table goes to stdout, or into the output file, which is
+ * only created once the table is complete and deleted on a write error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include "phash.h"
+
+#define MAXDISP 0x100000
+
+struct key {
+  char *name;
+  int idx;              /* index of the first mnemonic with this name */
+  uint64_t hash;
+  struct key *next;     /* next key in the same bucket */
+};
+
+struct bucket {
+  struct key *keys;
+  int cnt;
+  uint32_t num;
+};
+
+static char *fname;
+static int line;        /* 0 when not reading fname */
+static char *outname;
+static FILE *out;
+static int nentries;    /* number of entries in mnemonics[] */
+static struct key *keys;
+static int nkeys;
+static int lastkey=-1;  /* key of the previous entry */
+
+
+static void fail(char *msg)
+{
+  fprintf(stderr,"mkphash: %s",msg);
+  if (line)
+    fprintf(stderr," in line %d of \"%s\"",line,fname);
+  else if (outname)
+    fprintf(stderr," \"%s\"",outname);
+  fprintf(stderr,"!\n");
+  if (out) {
+    fclose(out);
+    remove(outname);  /* no partial table */
+  }
+  exit(EXIT_FAILURE);
+}
+
+
+static void *alloc(size_t sz)
+{
+  void *p = calloc(1,sz?sz:1);
+
+  if (p == NULL)
+    fail("out of memory");
+  return p;
+}
+
+
+static void add_entry(char *name,int len)
+/* add next mnemonic, consecutive entries with the same name share a key */
+{
+  int i;
+
+  for (i=0; i<len; i++)
+    name[i] = tolower((unsigned char)name[i]);
+  name[len] = '\0';
+  if (lastkey<0 || strcmp(keys[lastkey].name,name)) {
+    /* a later group of the same name hides an earlier one */
+    for (i=0; i<nkeys; i++) {
+      if (!strcmp(keys[i].name,name))
+        break;
+    }
+    if (i == nkeys) {
+      keys = realloc(keys,(nkeys+1)*sizeof(struct key));
+      if (keys == NULL)
+        fail("out of memory");
+      keys[i].name = strcpy(alloc(len+1),name);
+      keys[i].hash = phash_code(name,len);
+      nkeys++;
+    }
+    keys[i].idx = nentries;
+    lastkey = i;
+  }
+  nentries++;
+}
+
+
+static void read_opcodes(FILE *f)
+/* Every entry of opcodes.h starts with its name as the first token of
+   a line. Comments and "#if 0" blocks are skipped, other conditionals
+   are not supported. */
+{
+  char buf[1024],*p,*q;
+  int comment=0,skip=0;
+
+  while (fgets(buf,sizeof(buf),f)) {
+    line++;
+    for (p=buf; isspace((unsigned char)*p); p++);
+    if (comment) {
+      if (q = strstr(p,"*/")) {
+        comment = 0;
+        for (p=q+2; isspace((unsigned char)*p); p++);
+      }
+      else
+        continue;
+    }
+    if (*p == '#') {
+      for (p++; isspace((unsigned char)*p); p++);
+      if (!strncmp(p,"if",2)) {
+        if (skip || !strncmp(p,"if 0",4))
+          skip++;
+        else
+          fail("unsupported conditional");
+      }
+      else if (!strncmp(p,"endif",5)) {
+        if (skip)
+          skip--;
+      }
+      else if (!skip && strncmp(p,"define",6) && strncmp(p,"undef",5))
+        fail("unsupported preprocessor directive");
+      continue;
+    }
+    if (skip)
+      continue;
+    if (*p == '{')
+      for (p++; isspace((unsigned char)*p); p++);
+    if (*p == '"') {
+      for (q=++p; *q!='"'; q++) {
+        if (*q=='\0' || *q=='\\')
+          fail("bad mnemonic name");
+      }
+      add_entry(p,q-p);
+      p = q + 1;
+    }
+    /* look for an unterminated comment in the rest of the line */
+    while (p = strstr(p,"/*")) {
+      if (q = strstr(p+2,"*/"))
+        p = q + 2;
+      else {
+        comment = 1;
+        break;
+      }
+    }
+  }
+  if (skip || comment)
+    fail("unexpected end of file");
+}
+
+
+static int cmp_bucket(const void *a,const void *b)
+{
+  const struct bucket *b1=a,*b2=b;
+
+  if (b1->cnt != b2->cnt)
+    return b2->cnt - b1->cnt;
+  return b1->num<b2->num ? -1 : (b1->num>b2->num);
+}
+
+
+static int make_phash(uint32_t nbuckets,uint32_t size,
+                      uint32_t *disp,int32_t *idx)
+/* find a displacement for every bucket, so that all keys get their own
+   slot, try the buckets with the most keys first */
+{
+  struct bucket *b = alloc(nbuckets*sizeof(struct bucket));
+  uint32_t *slots = alloc(nkeys*sizeof(uint32_t));
+  struct key *k;
+  uint32_t i,d,n;
+  int j,rc=1;
+
+  for (i=0; i<nbuckets; i++)
+    b[i].num = i;
+  for (j=0; j<nkeys; j++) {
+    i = PHASH_BUCKET(keys[j].hash,nbuckets);
+    keys[j].next = b[i].keys;
+    b[i].keys = &keys[j];
+    b[i].cnt++;
+  }
+  qsort(b,nbuckets,sizeof(struct bucket),cmp_bucket);
+  for (i=0; i<size; i++)
+    idx[i] = -1;
+  memset(disp,0,nbuckets*sizeof(uint32_t));
+
+  for (i=0; i<nbuckets && b[i].cnt>0; i++) {
+    for (d=0; d<MAXDISP; d++) {
+      for (n=0,k=b[i].keys; k; k=k->next,n++) {
+        uint32_t s = phash_slot(k->hash,d,size-1);
+        uint32_t m;
+
+        if (idx[s] >= 0)
+          break;
+        for (m=0; m<n && slots[m]!=s; m++);
+        if (m < n)
+          break;
+        slots[n] = s;
+      }
+      if (k == NULL)
+        break;
+    }
+    if (d >= MAXDISP)
+      break;
+    for (n=0,k=b[i].keys; k; k=k->next,n++)
+      idx[slots[n]] = k->idx;
+    disp[b[i].num] = d;
+  }
+  if (i<nbuckets && b[i].cnt>0)
+    rc = 0;
+  free(slots);
+  free(b);
+  return rc;
+}
+
+
+static void write_table(char *name,uint32_t *tab,size_t n,int sign)
+{
+  size_t i;
+
+  fprintf(out,"const %s %s[] = {",sign?"int32_t":"uint32_t",name);
+  for (i=0; i<n; i++)
+    fprintf(out,sign?"%s%ld":"%s%lu",i%10?",":(i?",\n  ":"\n  "),
+            sign?(long)(int32_t)tab[i]:(unsigned long)tab[i]);
+  fprintf(out,n?"\n};\n":"\n  0\n};\n");
+}
+
+
+int main(int argc,char *argv[])
+{
+  uint32_t nbuckets=0,size=1,*disp,*idx;
+
+  if (argc > 3) {
+    fprintf(stderr,"Usage: %s [opcodes.h [output]]\n",argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (argc >= 2) {
+    FILE *f;
+
+    /* a cpu without opcodes.h gets the empty table */
+    if (f = fopen(argv[1],"r")) {
+      fname = argv[1];
+      read_opcodes(f);
+      fclose(f);
+      line = 0;
+      nbuckets = nkeys/4 + 1;
+      while (size < nkeys+nkeys/4)
+        size <<= 1;
+    }
+  }
+
+  disp = alloc(nbuckets*sizeof(uint32_t));
+  for (;;) {
+    idx = alloc(size*sizeof(uint32_t));
+    if (make_phash(nbuckets,size,disp,(int32_t *)idx))
+      break;
+    free(idx);
+    size <<= 1;
+  }
+
+  if (argc == 3) {
+    outname = argv[2];
+    if (!(out = fopen(outname,"w")))
+      fail("cannot open output file");
+  }
+  else
+    out = stdout;
+  fprintf(out,"/* generated by mkphash%s%s - do not edit */\n\n"
+          "#include <stdint.h>\n\n",fname?" from ":"",fname?fname:"");
+  fprintf(out,"const int mnemo_phash_cnt = %d;\n",fname?nentries:-1);
+  fprintf(out,"const uint32_t mnemo_phash_nbuckets = %lu;\n",
+          (unsigned long)nbuckets);
+  fprintf(out,"const uint32_t mnemo_phash_size = %lu;\n",
+          (unsigned long)size);
+  write_table("mnemo_phash_disp",disp,nbuckets,0);
+  write_table("mnemo_phash_idx",idx,size,1);
+  if (fflush(out) || ferror(out))
+    fail("write error");
+  if (out != stdout) {
+    FILE *f = out;
+
+    out = NULL;
+    if (fclose(f)) {
+      remove(outname);
+      fail("write error");
+    }
+  }
+  return 0;
+}
@@ -159,9 +159,11 @@ static void aout_initwrite(section *firstsec)
   initlist(&aoutstrlist.l);
   aoutstrlist.hashtab = mycalloc(STRHTABSIZE*sizeof(struct StrTabNode *));
   aoutstrlist.nextoffset = 4;  /* first string is always at offset 4 */
+  aoutstrlist.entries = aoutstrlist.chains = aoutstrlist.maxchain = 0;
   initlist(&aoutsymlist.l);
   aoutsymlist.hashtab = mycalloc(SYMHTABSIZE*sizeof(struct SymbolNode *));
   aoutsymlist.nextindex = 0;
+  aoutsymlist.entries = aoutsymlist.chains = aoutsymlist.maxchain = 0;
   initlist(&treloclist);
   initlist(&dreloclist);
 
@@ -201,11 +203,13 @@ static void aout_initwrite(section *firstsec)
 }
 
 
-static uint32_t aout_addstr(char *s)
-/* add a new symbol name to the string table and return its offset */
+static uint32_t aout_addstr(char *s,size_t hash)
+/* add a new symbol name with hashcode(s) to the string table and
+   return its offset */
 {
   struct StrTabNode **chain;
   struct StrTabNode *sn;
+  uint32_t len = 0;
 
   if (s == NULL)
     return 0;
@@ -213,12 +217,18 @@ static uint32_t aout_addstr(char *s)
     return 0;
 
   /* search string in hash table */
-  chain = &aoutstrlist.hashtab[hashcode(s)%STRHTABSIZE];
+  chain = &aoutstrlist.hashtab[hash%STRHTABSIZE];
   while (sn = *chain) {
     if (!strcmp(s,sn->str))
       return (sn->offset);  /* it's already in, return offset */
     chain = &sn->hashchain;
+    len++;
   }
+  aoutstrlist.entries++;
+  if (len == 0)
+    aoutstrlist.chains++;
+  if (len >= aoutstrlist.maxchain)
+    aoutstrlist.maxchain = len + 1;
 
   /* new string table entry */
   *chain = sn = mymalloc(sizeof(struct StrTabNode));
@@ -231,15 +241,16 @@ static uint32_t aout_addstr(char *s)
 }
 
 
-static struct SymbolNode *aout_addsym(char *name,uint8_t type,int8_t other,
-                                      int16_t desc,uint32_t value,int be)
+static struct SymbolNode *aout_addsym(char *name,size_t hash,uint8_t type,
+                                      int8_t other,int16_t desc,
+                                      uint32_t value,int be)
 /* append a new symbol to the symbol list */
 {
   struct SymbolNode *sym = mycalloc(sizeof(struct SymbolNode));
 
   sym->name = name!=NULL ? name : emptystr;
   sym->index = aoutsymlist.nextindex++;
-  setval(be,&sym->s.n_strx,4,aout_addstr(name));
+  setval(be,&sym->s.n_strx,4,aout_addstr(name,hash));
   sym->s.n_type = type;
   sym->s.n_other = other;
   setval(be,&sym->s.n_desc,2,desc);
@@ -254,13 +265,22 @@ static uint32_t aout_addsymhash(char *name,taddr value,int bind,
 /* add a new symbol, return its symbol table index */
 {
   struct SymbolNode **chain,*sym;
+  size_t hash = hashcode(name?name:emptystr);
+  uint32_t len = 0;
 
-  chain = &aoutsymlist.hashtab[hashcode(name?name:emptystr)%SYMHTABSIZE];
-  while (sym = *chain)
+  chain = &aoutsymlist.hashtab[hash%SYMHTABSIZE];
+  while (sym = *chain) {
     chain = &sym->hashchain;
+    len++;
+  }
+  aoutsymlist.entries++;
+  if (len == 0)
+    aoutsymlist.chains++;
+  if (len >= aoutsymlist.maxchain)
+    aoutsymlist.maxchain = len + 1;
 
   /* new symbol table entry */
-  *chain = sym = aout_addsym(name,type,((bind&0xf)<<4)|(info&0xf),
+  *chain = sym = aout_addsym(name,hash,type,((bind&0xf)<<4)|(info&0xf),
                              desc,value,be);
   return sym->index;
 }
@@ -350,19 +370,38 @@ static void aout_symconvert(symbol *sym,int symbind,int syminfo,int be)
 }
 
 
-static void aout_addsymlist(symbol *sym,int bind,int type,int be)
+static void aout_addsymlist(exportidx *x,int bind,int type,int be)
 /* add all symbols with specified bind and type to the a.out symbol list */
 {
-  for (; sym; sym=sym->next) {
+  unsigned classes;
+  symbol *sym;
+  size_t i;
+
+  switch (bind) {
+    case BIND_LOCAL:
+      classes = SYMBIT(SYMB_LOCAL);
+      break;
+    case BIND_GLOBAL:
+      classes = SYMBIT(SYMB_GLOBAL) | SYMBIT(SYMB_COMMON);
+      break;
+    case BIND_WEAK:
+      classes = SYMBIT(SYMB_WEAK);
+      break;
+    default:
+      ierror(0);
+      break;
+  }
+
+  for (i=0; i<x->nsyms; i++) {
+    if (!(SYMBIT(x->bind[i]) & classes))
+      continue;
+    sym = x->syms[i];
     /* ignore symbols preceded by a '.' and internal symbols */
-    if ((sym->type!=IMPORT || (sym->flags&WEAK) || (sym->flags&COMMON))
-        && *sym->name != '.' && *sym->name!=' ' && !(sym->flags&VASMINTERN)) {
+    if (*sym->name != '.' && *sym->name!=' ') {
       int syminfo = aout_getinfo(sym);
-      int symbind = aout_getbind(sym);
 
-      if (symbind == bind && (!type || (syminfo == type))) {
-        aout_symconvert(sym,symbind,syminfo,be);
-      }
+      if (!type || (syminfo == type))
+        aout_symconvert(sym,aout_getbind(sym),syminfo,be);
     }
   }
 }
@@ -385,7 +424,9 @@ static void aout_debugsyms(int be)
       else
         ierror(0);  /* @@@ handle external references! How? */
     }
-    aout_addsym(nlist->name.ptr,nlist->type,nlist->other,nlist->desc,val,be);
+    aout_addsym(nlist->name.ptr,
+                nlist->name.ptr!=NULL ? hashcode(nlist->name.ptr) : 0,
+                nlist->type,nlist->other,nlist->desc,val,be);
     nlist = nlist->next;
   }
 }
@@ -594,16 +635,16 @@ void aout_writestrings(FILE *f,int be)
 }
 
 
-static void write_output(FILE *f,section *sec,symbol *sym)
+static void write_output(FILE *f,section *sec,symbol *sym,exportidx *x)
 {
   int be = BIGENDIAN;
   uint32_t trsize,drsize;
 
   aout_initwrite(sec);
-  aout_addsymlist(sym,BIND_GLOBAL,0,be);
-  aout_addsymlist(sym,BIND_WEAK,0,be);
+  aout_addsymlist(x,BIND_GLOBAL,0,be);
+  aout_addsymlist(x,BIND_WEAK,0,be);
   if (!no_symbols) {
-    aout_addsymlist(sym,BIND_LOCAL,0,be);
+    aout_addsymlist(x,BIND_LOCAL,0,be);
     aout_debugsyms(be);
   }
   trsize = aout_addrelocs(be,_TEXT,&treloclist,aoutstd_getrinfo);
@@ -622,6 +663,23 @@ static void write_output(FILE *f,section *sec,symbol *sym)
   aout_writerelocs(f,&dreloclist);
   aout_writesymbols(f);
   aout_writestrings(f,be);
+
+  if (debug) {
+    printf("a.out string hashtable: %lu entries, %lu chains, "
+           "chain length avg %.2f, max %lu\n",
+           (unsigned long)aoutstrlist.entries,
+           (unsigned long)aoutstrlist.chains,
+           aoutstrlist.chains ?
+           (double)aoutstrlist.entries/aoutstrlist.chains : 0.0,
+           (unsigned long)aoutstrlist.maxchain);
+    printf("a.out symbol hashtable: %lu entries, %lu chains, "
+           "chain length avg %.2f, max %lu\n",
+           (unsigned long)aoutsymlist.entries,
+           (unsigned long)aoutsymlist.chains,
+           aoutsymlist.chains ?
+           (double)aoutsymlist.entries/aoutsymlist.chains : 0.0,
+           (unsigned long)aoutsymlist.maxchain);
+  }
 }
 
 
@@ -635,7 +693,7 @@ static int output_args(char *p)
 }
 
 
-int init_output_aout(char **cp,void (**wo)(FILE *,section *,symbol *),
+int init_output_aout(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),
                      int (**oa)(char *))
 {
   *cp = copyright;
@@ -646,7 +704,7 @@ int init_output_aout(char **cp,void (**wo)(FILE *,section *,symbol *),
 
 #else
 
-int init_output_aout(char **cp,void (**wo)(FILE *,section *,symbol *),
+int init_output_aout(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),
                      int (**oa)(char *))
 {
   return 0;
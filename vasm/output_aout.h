@@ -101,6 +101,7 @@ struct StrTabList {
   struct list l;
   struct StrTabNode **hashtab;
   uint32_t nextoffset;
+  uint32_t entries,chains,maxchain;  /* hash statistics */
 };
 
 struct SymbolNode {
@@ -115,6 +116,7 @@ struct SymTabList {
   struct list l;
   struct SymbolNode **hashtab;
   uint32_t nextindex;
+  uint32_t entries,chains,maxchain;  /* hash statistics */
 };
 
 struct RelocNode {
@@ -21,40 +21,47 @@ static int orgcmp(const void *sec1,const void *sec2)
 }
 
 
-static void write_output(FILE *f,section *sec,symbol *sym)
-{
-  section *s,*s2,**seclist,**slp;
-  atom *p;
-  size_t nsecs;
-  unsigned long long pc,npc,i;
+static unsigned long long pc;
+static int sections_written;
 
-  if (!sec)
-    return;
+
+static int check_output(section *sec,symbol *sym,int report)
+/* returns 1, when the sections cannot be written, errors are only shown
+   in report-mode */
+{
+  section *s,*s2;
 
   for (; sym; sym=sym->next) {
-    if (sym->type == IMPORT)
+    if (sym->type == IMPORT) {
+      if (!report)
+        return 1;
       output_error(6,sym->name);  /* undefined symbol */
+    }
   }
 
   /* we don't support overlapping sections */
-  for (s=sec,nsecs=0; s!=NULL; s=s->next) {
+  for (s=sec; s!=NULL; s=s->next) {
+    if (s->flags & UNALLOCATED)
+      continue;
     for (s2=s->next; s2; s2=s2->next) {
+      if (s2->flags & UNALLOCATED)
+        continue;
       if (((ULLTADDR(s2->org) >= ULLTADDR(s->org) &&
             ULLTADDR(s2->org) < ULLTADDR(s->pc)) ||
            (ULLTADDR(s2->pc) > ULLTADDR(s->org) &&
-            ULLTADDR(s2->pc) <= ULLTADDR(s->pc))))
+            ULLTADDR(s2->pc) <= ULLTADDR(s->pc)))) {
+        if (!report)
+          return 1;
         output_error(0);
+      }
     }
-    nsecs++;
   }
+  return 0;
+}
 
-  /* make an array of section pointers, sorted by their start address */
-  seclist = (section **)mymalloc(nsecs * sizeof(section *));
-  for (s=sec,slp=seclist; s!=NULL; s=s->next)
-    *slp++ = s;
-  if (nsecs > 1)
-    qsort(seclist,nsecs,sizeof(section *),orgcmp);
 
+static void write_header(FILE *f,section *sec)
+{
   if (binfmt == BINFMT_CBMPRG) {
     /* Commodore 6502 PRG header:
      * 00: LSB of load address
@@ -63,33 +70,91 @@ static void write_output(FILE *f,section *sec,symbol *sym)
     fw8(f,sec->org&0xff);
     fw8(f,(sec->org>>8)&0xff);
   }
+}
+
 
-  for (slp=seclist; nsecs>0; nsecs--) {
-    s = *slp++;
-    if (s!=seclist[0] && ULLTADDR(s->org)>pc) {
-      /* fill gap between sections with zeros */
-      for (; pc<ULLTADDR(s->org); pc++)
-        fw8(f,0);
+static void write_section(FILE *f,section *s)
+{
+  atom *p;
+  unsigned long long npc,i;
+
+  if (sections_written++ && ULLTADDR(s->org)>pc) {
+    /* fill gap between sections with zeros */
+    for (; pc<ULLTADDR(s->org); pc++)
+      fw8(f,0);
+  }
+  else
+    pc = ULLTADDR(s->org);
+
+  for (p=s->first; p; p=p->next) {
+    npc = ULLTADDR(fwpcalign(f,p,s,pc));
+    if (p->type == DATA) {
+      for (i=0; i<p->content.db->size; i++)
+        fw8(f,(unsigned char)p->content.db->data[i]);
     }
-    else
-      pc = ULLTADDR(s->org);
-
-    for (p=s->first; p; p=p->next) {
-      npc = ULLTADDR(fwpcalign(f,p,s,pc));
-      if (p->type == DATA) {
-        for (i=0; i<p->content.db->size; i++)
-          fw8(f,(unsigned char)p->content.db->data[i]);
-      }
-      else if (p->type == SPACE) {
-        fwsblock(f,p->content.sb);
-      }
-      pc = npc + atom_size(p,s,npc);
+    else if (p->type == SPACE) {
+      fwsblock(f,p->content.sb);
     }
+    pc = npc + atom_size(p,s,npc);
   }
+}
+
+
+static void write_output(FILE *f,section *sec,symbol *sym,exportidx *x)
+{
+  section *s,**seclist,**slp;
+  size_t nsecs;
+
+  if (!sec)
+    return;
+
+  check_output(sec,sym,1);
+
+  /* make an array of section pointers, sorted by their start address */
+  for (s=sec,nsecs=0; s!=NULL; s=s->next)
+    nsecs++;
+  seclist = (section **)mymalloc(nsecs * sizeof(section *));
+  for (s=sec,slp=seclist; s!=NULL; s=s->next)
+    *slp++ = s;
+  if (nsecs > 1)
+    qsort(seclist,nsecs,sizeof(section *),orgcmp);
+
+  write_header(f,sec);
+  for (slp=seclist; nsecs>0; nsecs--)
+    write_section(f,*slp++);
   free(seclist);
 }
 
 
+static int start_output(FILE *f,section *sec,symbol *sym)
+{
+  section *s,*first,*last;
+
+  /* streaming requires the sections to be already sorted by address */
+  for (s=sec,first=last=NULL; s; s=s->next) {
+    if (s->flags & UNALLOCATED)
+      continue;
+    if (last!=NULL && ULLTADDR(s->org)<ULLTADDR(last->org))
+      return 0;
+    if (first == NULL)
+      first = s;
+    last = s;
+  }
+  if (first==NULL || check_output(sec,sym,0))
+    return 0;  /* leave it to write_output() */
+
+  write_header(f,first);
+  return 1;
+}
+
+
+static void stream_output(FILE *f,section *sec)
+{
+  if (sec)
+    write_section(f,sec);
+}
+
+
 static int output_args(char *p)
 {
   if (!strcmp(p,"-cbm-prg")) {
@@ -100,17 +165,19 @@ static int output_args(char *p)
 }
 
 
-int init_output_bin(char **cp,void (**wo)(FILE *,section *,symbol *),int (**oa)(char *))
+int init_output_bin(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),int (**oa)(char *))
 {
   *cp = copyright;
   *wo = write_output;
   *oa = output_args;
+  start_stream = start_output;
+  stream_section = stream_output;
   return 1;
 }
 
 #else
 
-int init_output_bin(char **cp,void (**wo)(FILE *,section *,symbol *),int (**oa)(char *))
+int init_output_bin(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),int (**oa)(char *))
 {
   return 0;
 }
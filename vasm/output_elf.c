@@ -517,34 +517,40 @@ static utaddr prog_sec_hdrs(section *sec,utaddr soffset,
 }
 
 
-static unsigned build_symbol_table(symbol *first,
+static unsigned build_symbol_table(exportidx *x,
                                    void (*newsym)(char *,elfull,elfull,
                                                   uint8_t,uint8_t,
                                                   unsigned))
 {
   symbol *symp;
   unsigned firstglobal;
+  size_t i;
 
   /* file name symbol, when defined */
   if (filename)
     newsym(filename,0,0,STB_LOCAL,STT_FILE,SHN_ABS);
 
-  if (!no_symbols)  /* symbols with local binding first */
-    for (symp=first; symp; symp=symp->next)
-      if (*symp->name!='.' && *symp->name!=' ' && !(symp->flags&VASMINTERN))
-        if (symp->type!=IMPORT && !(symp->flags & (EXPORT|WEAK)))
-          newsym(symp->name,get_sym_value(symp),get_sym_size(symp),
-                 STB_LOCAL,get_sym_info(symp),get_sym_index(symp));
+  if (!no_symbols) {  /* symbols with local binding first */
+    for (i=x->first[SYMB_LOCAL]; i<x->first[SYMB_LOCAL+1]; i++) {
+      symp = x->bybind[i];
+      if (*symp->name!='.' && *symp->name!=' ')
+        newsym(symp->name,get_sym_value(symp),get_sym_size(symp),
+               STB_LOCAL,get_sym_info(symp),get_sym_index(symp));
+    }
+  }
 
   firstglobal = symindex;  /* now the global and weak symbols */
 
-  for (symp=first; symp; symp=symp->next)
-    if (*symp->name != '.'  && !(symp->flags&VASMINTERN))
-      if ((symp->type!=IMPORT && (symp->flags & (EXPORT|WEAK))) ||
-          (symp->type==IMPORT && (symp->flags & (COMMON|WEAK))))
+  for (i=0; i<x->nsyms; i++) {
+    if (SYMBIT(x->bind[i]) &
+        (SYMBIT(SYMB_GLOBAL)|SYMBIT(SYMB_WEAK)|SYMBIT(SYMB_COMMON))) {
+      symp = x->syms[i];
+      if (*symp->name != '.')
         newsym(symp->name,get_sym_value(symp),get_sym_size(symp),
                (symp->flags & WEAK) ? STB_WEAK : STB_GLOBAL,
                get_sym_info(symp),get_sym_index(symp));
+    }
+  }
 
   return firstglobal;
 }
@@ -658,7 +664,7 @@ static void write_section_data(FILE *f,section *sec)
 }
 
 
-static void write_ELF64(FILE *f,section *sec,symbol *sym)
+static void write_ELF64(FILE *f,section *sec,exportidx *x)
 {
   struct Elf64_Ehdr header;
   unsigned firstglobal,align1,align2,i;
@@ -683,7 +689,7 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
 
   /* make program section headers, symbols and relocations */
   soffset = prog_sec_hdrs(sec,soffset,makeShdr64,newSym64);
-  firstglobal = build_symbol_table(sym,newSym64);
+  firstglobal = build_symbol_table(x,newSym64);
   make_reloc_sections(sec,newSym64,addRel64,makeShdr64);
 
   /* ".shstrtab" section header string table */
@@ -758,7 +764,7 @@ static void write_ELF64(FILE *f,section *sec,symbol *sym)
 }
 
 
-static void write_ELF32(FILE *f,section *sec,symbol *sym)
+static void write_ELF32(FILE *f,section *sec,exportidx *x)
 {
   struct Elf32_Ehdr header;
   unsigned firstglobal,align1,align2,i;
@@ -786,7 +792,7 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
 
   /* make program section headers, symbols and relocations */
   soffset = prog_sec_hdrs(sec,soffset,makeShdr32,newSym32);
-  firstglobal = build_symbol_table(sym,newSym32);
+  firstglobal = build_symbol_table(x,newSym32);
   make_reloc_sections(sec,newSym32,addRel32,makeShdr32);
 
   /* ".shstrtab" section header string table */
@@ -861,7 +867,7 @@ static void write_ELF32(FILE *f,section *sec,symbol *sym)
 }
 
 
-static void write_output(FILE *f,section *sec,symbol *sym)
+static void write_output(FILE *f,section *sec,symbol *sym,exportidx *x)
 {
   cpu = ELFCPU;    /* cpu ID */
   be = BIGENDIAN;  /* true for big endian */
@@ -869,14 +875,14 @@ static void write_output(FILE *f,section *sec,symbol *sym)
   shtreloc = RELA ? SHT_RELA : SHT_REL;
 
   if (bits==32 && cpu!=EM_NONE)
-    write_ELF32(f,sec,sym);
+    write_ELF32(f,sec,x);
   else if (bits==64 && cpu!=EM_NONE)
-    write_ELF64(f,sec,sym);
+    write_ELF64(f,sec,x);
   else
     output_error(1,cpuname);  /* output module doesn't support cpu */
 
-  if (debug && elfsymhash->collisions)
-    printf("*** %d ELF symbol collisions!\n",elfsymhash->collisions);
+  if (debug)
+    print_hashstats(stdout,elfsymhash,"ELF symbol");
 }
 
 
@@ -890,7 +896,7 @@ static int output_args(char *p)
 }
 
 
-int init_output_elf(char **cp,void (**wo)(FILE *,section *,symbol *),
+int init_output_elf(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),
                     int (**oa)(char *))
 {
   *cp = copyright;
@@ -901,7 +907,7 @@ int init_output_elf(char **cp,void (**wo)(FILE *,section *,symbol *),
 
 #else
 
-int init_output_elf(char **cp,void (**wo)(FILE *,section *,symbol *),
+int init_output_elf(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),
                     int (**oa)(char *))
 {
   return 0;
@@ -316,4 +316,4 @@ struct Rel64Node {
 #define ELFCPU 0
 #endif
 
-#define ELFSYMHTABSIZE 0x10000
+#define ELFSYMHTABSIZE 0x400
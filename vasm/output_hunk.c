@@ -878,7 +878,7 @@ static void write_exec(FILE *f,section *sec,symbol *sym)
 }
 
 
-static void write_output(FILE *f,section *sec,symbol *sym)
+static void write_output(FILE *f,section *sec,symbol *sym,exportidx *x)
 {
   if (exec_out)
     write_exec(f,sec,sym);
@@ -923,7 +923,7 @@ static int exec_args(char *p)
 }
 
 
-int init_output_hunk(char **cp,void (**wo)(FILE *,section *,symbol *),
+int init_output_hunk(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),
                      int (**oa)(char *))
 {
   *cp = copyright;
@@ -934,7 +934,7 @@ int init_output_hunk(char **cp,void (**wo)(FILE *,section *,symbol *),
 
 #else
 
-int init_output_hunk(char **cp,void (**wo)(FILE *,section *,symbol *),
+int init_output_hunk(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),
                      int (**oa)(char *))
 {
   return 0;
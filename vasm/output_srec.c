@@ -282,16 +282,8 @@ static void addralign(FILE *f,atom *a,section *sec)
   }
 }
 
-static void write_output(FILE *f,section *sec,symbol *sym)
+static void check_output(symbol *sym)
 {
-  section *s,*s2,**seclist,**slp;
-  atom *p;
-  size_t nsecs;
-  unsigned long long i, j;
-
-  if (!sec)
-    return;
-
   for (; sym; sym=sym->next) {
     if (sym->type == IMPORT)
       output_error(6,sym->name);  /* undefined symbol */
@@ -305,44 +297,94 @@ static void write_output(FILE *f,section *sec,symbol *sym)
   if (start_sym != NULL) /* if start_name is not NULL, then it means we set it
                              but we were unable to find it */
     output_error(6, start_sym);
+}
 
-  for (s=sec; s!=NULL; s=s->next)	/* iterate through sections */
+static void write_section(FILE *f,section *s)
+{
+  atom *p;
+  unsigned long long i, j;
+
+  for (data_size = 0; (*(s->name + data_size) != '\0') && (data_size < 32); data_size++)
+  /* loop loads name of section into data and sets data_size properly */
   {
-    for (data_size = 0; (*(s->name + data_size) != '\0') && (data_size < 32); data_size++)
-    /* loop loads name of section into data and sets data_size properly */
-    {
-      data[data_size] = *(s->name + data_size);
-    }
-    write_data_buffer(f, 0); /* record type is S0 for header */
-    
-    pc = ULLTADDR(s->org);	/* start at the org address */
-    srec_pc = pc;		/* need to update both */
-    for (p=s->first; p; p=p->next)	/* iterate through atoms */
+    data[data_size] = *(s->name + data_size);
+  }
+  write_data_buffer(f, 0); /* record type is S0 for header */
+  
+  pc = ULLTADDR(s->org);	/* start at the org address */
+  srec_pc = pc;		/* need to update both */
+  for (p=s->first; p; p=p->next)	/* iterate through atoms */
+  {
+    addralign(f,p,s);
+    if(p->type == DATA)
+      for (i = 0; i < p->content.db->size; i++)
+        put_byte_in_buffer(f,(uint8_t)p->content.db->data[i]);
+    else if (p->type == SPACE)
     {
-      addralign(f,p,s);
-      if(p->type == DATA)
-        for (i = 0; i < p->content.db->size; i++)
-          put_byte_in_buffer(f,(uint8_t)p->content.db->data[i]);
-      else if (p->type == SPACE)
+      for (i = 0; i < p->content.sb->space; i++)
       {
-        for (i = 0; i < p->content.sb->space; i++)
+        for (j = 0; j < p->content.sb->size; j++)
         {
-          for (j = 0; j < p->content.sb->size; j++)
-          {
-            put_byte_in_buffer(f,p->content.sb->fill[j]);
-          }
+          put_byte_in_buffer(f,p->content.sb->fill[j]);
         }
-      } 
-    }
-    
-    write_data_buffer(f, srecfmt); /* now that we're done iterating through atoms */
-    /* flush buffer before moving on to next section */
+      }
+    } 
   }
   
+  write_data_buffer(f, srecfmt); /* now that we're done iterating through atoms */
+  /* flush buffer before moving on to next section */
+}
+
+static void write_output(FILE *f,section *sec,symbol *sym,exportidx *x)
+{
+  section *s;
+
+  if (!sec)
+    return;
+
+  check_output(sym);
+
+  for (s=sec; s!=NULL; s=s->next)	/* iterate through sections */
+    write_section(f,s);
+  
   /* after all sections finished, write terminating record */
   write_termination_record(f);
 }
 
+static int start_output(FILE *f,section *sec,symbol *sym)
+{
+  symbol *s;
+  char *name = start_sym;
+
+  for (; sec; sec=sec->next)
+    if (!(sec->flags & UNALLOCATED))
+      break;
+  if (sec == NULL)
+    return 0; /* no sections to write */
+
+  for (s=sym; s; s=s->next)
+  {
+    if (s->type == IMPORT)
+      return 0; /* leave the error to write_output() */
+    if (name != NULL && !strcmp(s->name, name))
+      name = NULL;
+  }
+  if (name != NULL)
+    return 0;
+
+  check_output(sym);
+  return 1;
+}
+
+static void stream_output(FILE *f,section *sec)
+/* writes one section, or the terminating record when sec is NULL */
+{
+  if (sec)
+    write_section(f,sec);
+  else
+    write_termination_record(f);
+}
+
 
 static int output_args(char *p)
 {
@@ -377,17 +419,19 @@ static int output_args(char *p)
 }
 
 
-int init_output_srec(char **cp,void (**wo)(FILE *,section *,symbol *),int (**oa)(char *))
+int init_output_srec(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),int (**oa)(char *))
 {
   *cp = copyright;
   *wo = write_output;
   *oa = output_args;
+  start_stream = start_output;
+  stream_section = stream_output;
   return 1;
 }
 
 #else
 
-int init_output_srec(char **cp,void (**wo)(FILE *,section *,symbol *),int (**oa)(char *))
+int init_output_srec(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),int (**oa)(char *))
 {
   return 0;
 }
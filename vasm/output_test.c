@@ -5,7 +5,7 @@
 
 static char *copyright="vasm test output module 1.0 (c) 2002 Volker Barthelmann";
 
-static void write_output(FILE *f,section *sec,symbol *sym)
+static void write_output(FILE *f,section *sec,symbol *sym,exportidx *x)
 {
   fprintf(f,"Sections:\n");
   for(;sec;sec=sec->next)
@@ -24,7 +24,7 @@ static int output_args(char *p)
   return 0;
 }
 
-int init_output_test(char **cp,void (**wo)(FILE *,section *,symbol *),int (**oa)(char *))
+int init_output_test(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),int (**oa)(char *))
 {
   *cp=copyright;
   *wo=write_output;
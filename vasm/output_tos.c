@@ -344,7 +344,7 @@ static int tos_writerelocs(FILE *f,section *sec)
 }
 
 
-static void write_output(FILE *f,section *sec,symbol *sym)
+static void write_output(FILE *f,section *sec,symbol *sym,exportidx *x)
 {
   int nsyms = tos_initwrite(sec,sym);
   int nrelocs = 0;
@@ -378,7 +378,7 @@ static int output_args(char *p)
 }
 
 
-int init_output_tos(char **cp,void (**wo)(FILE *,section *,symbol *),
+int init_output_tos(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),
                     int (**oa)(char *))
 {
   *cp = copyright;
@@ -389,7 +389,7 @@ int init_output_tos(char **cp,void (**wo)(FILE *,section *,symbol *),
 
 #else
 
-int init_output_tos(char **cp,void (**wo)(FILE *,section *,symbol *),
+int init_output_tos(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),
                     int (**oa)(char *))
 {
   return 0;
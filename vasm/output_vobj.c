@@ -98,6 +98,16 @@ static int sym_valid(symbol *symp)
   return 1;
 }
 
+static void write_symbol(FILE *f,symbol *symp)
+{
+  write_string(f,symp->name);
+  write_number(f,symp->type);
+  write_number(f,symp->flags);
+  write_number(f,symp->sec?symp->sec->idx:0);
+  write_number(f,get_sym_value(symp));
+  write_number(f,get_sym_size(symp));
+}
+
 static int count_relocs(rlist *rl)
 {
   int nrelocs;
@@ -192,12 +202,13 @@ static void write_relocs(FILE *f,section *sec)
   }
 }
 
-static void write_output(FILE *f,section *sec,symbol *sym)
+static void write_output(FILE *f,section *sec,symbol *sym,exportidx *x)
 {
   int nsyms,nsecs;
   section *secp;
   symbol *symp,*first,*last;
   taddr size,data,nrelocs;
+  size_t i;
 
   /* assign section index, make section symbols */
   for(nsecs=1,secp=sec,first=sym,last=NULL;secp;secp=secp->next){
@@ -217,11 +228,15 @@ static void write_output(FILE *f,section *sec,symbol *sym)
       first=symp;
     last=symp;
   }
-  /* assign symbol index to all symbols */
-  for(nsyms=1,symp=first;symp;symp=symp->next){
+  /* assign symbol index to all symbols, section symbols first */
+  for(nsyms=1,symp=first;symp!=sym;symp=symp->next){
     if(sym_valid(symp))
       symp->idx=nsyms++;
   }
+  for(i=0;i<x->nsyms;i++){
+    if(x->bind[i]!=SYMB_INTERN&&sym_valid(x->syms[i]))
+      x->syms[i]->idx=nsyms++;
+  }
 
   fw32(f,0x564f424a,1); /* "VOBJ" */
   if(BIGENDIAN)
@@ -236,15 +251,13 @@ static void write_output(FILE *f,section *sec,symbol *sym)
   write_number(f,nsecs-1);
   write_number(f,nsyms-1);
 
-  for(symp=first;symp;symp=symp->next){
-    if(!sym_valid(symp))
-      continue;
-    write_string(f,symp->name);
-    write_number(f,symp->type);
-    write_number(f,symp->flags);
-    write_number(f,symp->sec?symp->sec->idx:0);
-    write_number(f,get_sym_value(symp));
-    write_number(f,get_sym_size(symp));
+  for(symp=first;symp!=sym;symp=symp->next){
+    if(sym_valid(symp))
+      write_symbol(f,symp);
+  }
+  for(i=0;i<x->nsyms;i++){
+    if(x->bind[i]!=SYMB_INTERN&&sym_valid(x->syms[i]))
+      write_symbol(f,x->syms[i]);
   }
 
   for(secp=sec;secp;secp=secp->next){
@@ -266,7 +279,7 @@ static int output_args(char *p)
   return 0;
 }
 
-int init_output_vobj(char **cp,void (**wo)(FILE *,section *,symbol *),int (**oa)(char *))
+int init_output_vobj(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),int (**oa)(char *))
 {
   *cp=copyright;
   *wo=write_output;
@@ -276,7 +289,7 @@ int init_output_vobj(char **cp,void (**wo)(FILE *,section *,symbol *),int (**oa)
 
 #else
 
-int init_output_vobj(char **cp,void (**wo)(FILE *,section *,symbol *),int (**oa)(char *))
+int init_output_vobj(char **cp,void (**wo)(FILE *,section *,symbol *,exportidx *),int (**oa)(char *))
 {
   return 0;
 }
@@ -297,10 +297,9 @@ char *parse_symbol(char **s)
 {
   char *name;
 
-  name = get_local_label(s);
-  if (name == NULL)
-    name = parse_identifier(s);
-  return name;
+  if (name = get_local_label(s))
+    return mystrdup(name);
+  return parse_identifier(s);
 }
 
 
@@ -525,22 +524,26 @@ macro *new_macro(char *name,struct namelen *endmlist,char *args)
 {
   hashdata data;
   macro *m = NULL;
+  int idx;
 
   if (cur_macro==NULL && cur_src!=NULL && enddir_list==NULL) {
     m = mymalloc(sizeof(macro));
-    m->name = mystrdup(name);
-    if (nocase_macros)
-      strtolower(m->name);
+    if (nocase_macros) {
+      char *lcname = strtolower(mystrdup(name));
+
+      m->name = intern_name(lcname);
+      myfree(lcname);
+    }
+    else
+      m->name = intern_name(name);
     m->num_argnames = -1;
     m->argnames = m->defaults = NULL;
     m->recursions = 0;
     m->vararg = -1;
 
-    if (find_name_nc(mnemohash,name,&data)) {
-      int idx;
-
+    if ((idx = find_mnemonic(name,strlen(name),1)) >= 0) {
       m->text = cur_src->srcptr;
-      for (idx=data.idx;
+      for (;
            idx<mnemonic_cnt && !stricmp(mnemonics[idx].name,name); idx++) {
         if (MNEMONIC_VALID(idx)) {
           m->text = NULL;
@@ -796,7 +799,7 @@ static void start_repeat(char *rept_end)
 
   if (rept_cnt != 0) {
     sprintf(buf,"REPEAT:%s:line %d",cur_src->name,cur_src->line);
-    src = new_source(mystrdup(buf),rept_start,rept_end-rept_start);
+    src = new_source(buf,rept_start,rept_end-rept_start);
     src->irpname = rept_name;
     src->irpvals = NULL;
 #ifdef REPTNSYM
@@ -0,0 +1,36 @@
+/* phash.h  perfect hash for the static mnemonic table */
+
+/* The table is generated at build time by mkphash from the cpu's
+   opcodes.h. A name is hashed once, folded to lower case. The upper
+   32 bits select a bucket, whose displacement then determines the
+   collision-free slot, which holds the index of the first mnemonic
+   with this name, or -1. */
+
+#define PHASH_BUCKET(h,nbuckets) ((uint32_t)((h)>>32)%(uint32_t)(nbuckets))
+
+static uint64_t phash_code(const char *name,int len)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+
+  while (len-- > 0) {
+    h ^= (unsigned char)tolower((unsigned char)*name++);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static uint32_t phash_slot(uint64_t h,uint32_t disp,uint32_t mask)
+{
+  h ^= (uint64_t)disp * 0x9e3779b97f4a7c15ULL;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return (uint32_t)h & mask;
+}
+
+/* generated tables, mnemo_phash_cnt is -1 when there is none */
+extern const int mnemo_phash_cnt;
+extern const uint32_t mnemo_phash_nbuckets;
+extern const uint32_t mnemo_phash_size;
+extern const uint32_t mnemo_phash_disp[];
+extern const int32_t mnemo_phash_idx[];
@@ -373,6 +373,102 @@ int flt_chkrange(tfloat f,int bits)
 }
 
 
+/* Highest power of ten which is exact in a tfloat: 5^n needs n*log2(5)
+   mantissa bits, the factor 2^n goes into the exponent. */
+#define MAXEXACTPOW10 ((TFLOAT_MANT_DIG*1000)/2322)
+#define MAXDECDIGITS 19  /* always fit into an uint64_t */
+
+tfloat str2tfloat(char *s,char **endp)
+/* Read a decimal floating point constant. When the significant digits
+   and the power of ten are both exact in a tfloat, the result is a
+   single, correctly rounded multiplication or division. Everything else
+   (long mantissas, large exponents, hex-floats) is left to strtotfloat(). */
+{
+#if TFLOAT_MANT_DIG<64 && defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD>0
+  /* excess precision would round twice */
+  return strtotfloat(s,endp);
+#else
+  static tfloat p10[MAXEXACTPOW10+1];
+  uint64_t w=0,maxw,m;
+  int ndig=0,nd=0,e10=0,e,i;
+  char *p=s,*q;
+
+  if (p[0]=='0' && (p[1]=='x' || p[1]=='X'))
+    return strtotfloat(s,endp);
+  for (; *p>='0' && *p<='9'; p++,nd++) {
+    if (w!=0 || *p!='0') {
+      if (++ndig > MAXDECDIGITS)
+        return strtotfloat(s,endp);
+      w = w*10 + (*p-'0');
+    }
+  }
+  if (*p == '.') {
+    for (p++; *p>='0' && *p<='9'; p++,nd++) {
+      if (w!=0 || *p!='0') {
+        if (++ndig > MAXDECDIGITS)
+          return strtotfloat(s,endp);
+        w = w*10 + (*p-'0');
+      }
+      e10--;
+    }
+  }
+  if (nd == 0)
+    return strtotfloat(s,endp);
+  if (*p=='e' || *p=='E') {
+    int neg = 0;
+
+    q = p + 1;
+    if (*q=='+' || *q=='-')
+      neg = *q++ == '-';
+    if (*q>='0' && *q<='9') {
+      for (e=0; *q>='0' && *q<='9'; q++) {
+        if (e < 100000)
+          e = e*10 + (*q-'0');
+      }
+      e10 += neg ? -e : e;
+      p = q;
+    }
+  }
+
+  if (w == 0) {
+    if (endp)
+      *endp = p;
+    return 0.0;
+  }
+#if TFLOAT_MANT_DIG<64
+  maxw = (uint64_t)1 << TFLOAT_MANT_DIG;
+#else
+  maxw = ~(uint64_t)0;
+#endif
+  if (w > maxw)
+    return strtotfloat(s,endp);
+  if (e10 > MAXEXACTPOW10) {
+    /* move excess zeros into the mantissa, if it stays exact */
+    e = e10 - MAXEXACTPOW10;
+    if (e >= MAXDECDIGITS)
+      return strtotfloat(s,endp);
+    for (m=1; e>0; e--)
+      m *= 10;
+    if (w > maxw/m)
+      return strtotfloat(s,endp);
+    w *= m;
+    e10 = MAXEXACTPOW10;
+  }
+  else if (e10 < -MAXEXACTPOW10)
+    return strtotfloat(s,endp);
+
+  if (p10[0] == 0.0) {
+    p10[0] = 1.0;
+    for (i=1; i<=MAXEXACTPOW10; i++)
+      p10[i] = p10[i-1] * 10.0;
+  }
+  if (endp)
+    *endp = p;
+  return e10<0 ? (tfloat)w/p10[-e10] : (tfloat)w*p10[e10];
+#endif
+}
+
+
 void fw8(FILE *f,uint8_t x)
 {
   if (fputc(x,f) == EOF)
@@ -39,6 +39,7 @@ void conv2ieee64(int,uint8_t *,tfloat);
 void conv2ieee80(int,uint8_t *,tfloat);
 void conv2ieee128(int,uint8_t *,tfloat);
 int flt_chkrange(tfloat,int);
+tfloat str2tfloat(char *,char **);
 
 void fw8(FILE *,uint8_t);
 void fw16(FILE *,uint16_t,int);
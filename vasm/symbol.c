@@ -7,14 +7,54 @@
 symbol *first_symbol=NULL;
 static symbol *saved_symbol=NULL;
 
+/* Symbols created during a tentative parse are stamped with the generation
+   of that attempt. A rollback only truncates the symbol list and marks the
+   generation as dead. Dead symbols stay in the hash tables, are ignored by
+   find_symbol() and are reused when a symbol of the same name is created
+   again. Until then they point to themselves, instead of being in the
+   symbol list. Saving the symbols starts a new generation, which commits
+   the previous one. Symbols made outside of a tentative parse belong to
+   generation 0. */
+static int tentative;           /* save_symbols() was called */
+static int new_protected;       /* protected symbol made in this generation */
+static uint32_t cur_gen;        /* generation of new symbols, 0 when none */
+static uint32_t last_gen;
+static unsigned char *dead_gens;  /* bitmap of rolled back generations */
+static size_t dead_gens_size;
+static symbol *dead_hit;        /* dead symbol found by last find_symbol() */
+
+/* Symbols are allocated from a pool of fixed size chunks, which keeps them
+   close together in creation order. A symbol can be addressed by its
+   32-bit handle, its index in the pool. Handle 0 is never used. */
+#define SYMCHUNKSHIFT 12
+#define SYMCHUNKSIZE (1<<SYMCHUNKSHIFT)
+static symbol **symchunks;
+static uint32_t nsymchunks;
+static uint32_t nsyms;          /* next free handle */
+#define DEAD(p) ((p)->gen!=0 && (dead_gens[(p)->gen>>3]&(1<<((p)->gen&7))))
+
 static char *last_global_label=emptystr;
 
 #ifndef SYMHTABSIZE
-#define SYMHTABSIZE 0x10000
+#define SYMHTABSIZE 0x400
 #endif
 static hashtable *symhash;
 static hashtable *regsymhash;
 
+/* Local labels are kept in a small hash table for each scope, which is
+   the global label they belong to. The symbol is still named
+   " global_label local_label", the table key is its local part. */
+typedef struct scope {
+  char *name;           /* global label, from the identifier pool */
+  int len;
+  hashtable *locals;
+} scope;
+
+static hashtable *scopehash;
+static scope *cur_scope;        /* scope of last_global_label, once used */
+static char *last_local;        /* last name made by make_local_label() */
+static scope *last_local_scope;
+
 
 static void print_type(FILE *f,symbol *p)
 {
@@ -90,22 +130,182 @@ char *get_bind_name(symbol *p)
 }
 
 
-void add_symbol(symbol *p)
+static scope *find_scope(char *glob,int glen,int create)
+{
+  hashdata data;
+  scope *sc;
+
+  if (cur_scope && cur_scope->len==glen &&
+      !(nocase ? strnicmp(cur_scope->name,glob,glen) :
+                 strncmp(cur_scope->name,glob,glen)))
+    return cur_scope;
+  if (find_namelen(scopehash,glob,glen,&data))
+    return data.ptr;
+  if (!create)
+    return NULL;
+
+  sc = mymalloc(sizeof(scope));
+  sc->name = intern_namelen(glob,glen);
+  sc->len = glen;
+  sc->locals = new_hashtable(0);
+  data.ptr = sc;
+  add_hashentry(scopehash,sc->name,data);
+  return sc;
+}
+
+
+static scope *current_scope(void)
+{
+  if (cur_scope == NULL)
+    cur_scope = find_scope(last_global_label,strlen(last_global_label),1);
+  return cur_scope;
+}
+
+
+static void enter_scope(char *name)
+/* a new global label becomes the scope for local labels */
+{
+#ifdef CLOSE_LOCAL_SCOPES
+  scope *sc = cur_scope;
+
+  /* the syntax cannot refer to local labels of a previous scope */
+  if (sc!=NULL && strcmp(sc->name,name)) {
+    rem_hashentry(scopehash,sc->name,nocase);
+    free_hashtable(sc->locals);
+    myfree(sc);
+    if (last_local_scope == sc)
+      last_local = NULL;
+  }
+#endif
+  last_global_label = name;
+  cur_scope = NULL;
+}
+
+
+static char *split_local(char *name,scope **sc,int create)
+/* Returns the local part of a local label name and its scope, or NULL
+   when name is not a local label. */
+{
+  char *loc;
+
+  if (name == last_local) {
+    *sc = last_local_scope;
+    return name + last_local_scope->len + 2;
+  }
+  if (*name!=' ' || (loc = strrchr(name,' ')) == name)
+    return NULL;
+  *sc = find_scope(name+1,loc-name-1,create);
+  return loc + 1;
+}
+
+
+static void hash_symbol(symbol *sym,char *name)
 {
   hashdata data;
+  scope *sc;
+  char *loc;
+
+  data.ptr = sym;
+  if (loc = split_local(name,&sc,1))
+    add_hashentry(sc->locals,loc,data);
+  else
+    add_hashentry(symhash,name,data);
+}
+
+
+static uint32_t generation(void)
+{
+  if (!tentative)
+    return 0;
+  if (cur_gen == 0) {
+    cur_gen = ++last_gen;
+    if ((cur_gen>>3) >= dead_gens_size) {
+      size_t n = dead_gens_size ? dead_gens_size*2 : 0x100;
+
+      dead_gens = myrealloc(dead_gens,n);
+      memset(dead_gens+dead_gens_size,0,n-dead_gens_size);
+      dead_gens_size = n;
+    }
+  }
+  return cur_gen;
+}
 
+
+symbol *alloc_symbol(void)
+/* allocate an uninitialized symbol from the pool */
+{
+  symbol *p;
+
+  if (nsyms == 0)
+    nsyms = 1;
+  if ((nsyms>>SYMCHUNKSHIFT) >= nsymchunks) {
+    if (nsymchunks >= (0xffffffffUL>>SYMCHUNKSHIFT))
+      general_error(17);  /* out of memory */
+    symchunks = myrealloc(symchunks,(nsymchunks+1)*sizeof(symbol *));
+    symchunks[nsymchunks++] = mymalloc(SYMCHUNKSIZE*sizeof(symbol));
+  }
+  p = &symchunks[nsyms>>SYMCHUNKSHIFT][nsyms&(SYMCHUNKSIZE-1)];
+  p->handle = nsyms++;
+  return p;
+}
+
+
+symbol *symbol_ptr(uint32_t h)
+/* the symbol for a handle */
+{
+  if (h==0 || h>=nsyms)
+    ierror(0);
+  return &symchunks[h>>SYMCHUNKSHIFT][h&(SYMCHUNKSIZE-1)];
+}
+
+
+void add_symbol(symbol *p)
+{
   p->next = first_symbol;
   first_symbol = p;
-  data.ptr = p;
-  add_hashentry(symhash,p->name,data);
+  p->gen = generation();
+  hash_symbol(p,p->name);
+}
+
+
+static symbol *new_symbol(char *name)
+/* make a new symbol, which was not found by find_symbol(name) */
+{
+  symbol *p = dead_hit;
+
+  if (p!=NULL && p->next==p && !strcmp(p->name,name)) {
+    /* revive a symbol from a rolled back parse, it is still hashed */
+    p->next = first_symbol;
+    first_symbol = p;
+    p->gen = generation();
+  }
+  else {
+    p = alloc_symbol();
+    p->name = intern_name(name);
+    add_symbol(p);
+  }
+  dead_hit = NULL;
+  return p;
 }
 
 
 symbol *find_symbol(char *name)
 {
   hashdata data;
-  if (!find_name(symhash,name,&data))
+  scope *sc;
+  char *loc;
+
+  dead_hit = NULL;
+  if (loc = split_local(name,&sc,0)) {
+    if (sc==NULL || !find_name(sc->locals,loc,&data))
+      return 0;
+  }
+  else if (!find_name(symhash,name,&data))
+    return 0;
+  if (DEAD((symbol *)data.ptr)) {
+    dead_hit = data.ptr;
     return 0;
+  }
   return data.ptr;
 }
 
@@ -113,9 +313,7 @@ symbol *find_symbol(char *name)
 void refer_symbol(symbol *sym,char *refname)
 /* refer to an existing symbol with an additional name */
 {
-  hashdata data;
-  data.ptr=sym;
-  add_hashentry(symhash,refname,data);
+  hash_symbol(sym,refname);
 }
 
 
@@ -123,6 +321,9 @@ void save_symbols(void)
 /* remember current list of symbols to be restored later */
 {
   saved_symbol = first_symbol;
+  tentative = 1;
+  new_protected = 0;
+  cur_gen = 0;
 }
 
 
@@ -132,30 +333,42 @@ void restore_symbols(void)
   symbol *firstprot=NULL, *lastprot=NULL;
   symbol *symp;
 
-  if (saved_symbol) {
+  if (!tentative)
+    return;
+  if (cur_gen) {
     while (first_symbol != saved_symbol) {
       symp = first_symbol;
       first_symbol = symp->next;
-      if (symp->flags & PROTECTED) {
+      if (new_protected && (symp->flags & PROTECTED)) {
         /* keep this symbol */
+        symp->gen = 0;
         symp->next = firstprot;
         firstprot = symp;
         if (!lastprot)
           lastprot = symp;
       }
-      else {
-        rem_hashentry(symhash,symp->name,nocase);
-        /* myfree(symp->name);  could be dangerous? */
-        myfree(symp);
-      }
+      else
+        symp->next = symp;  /* unlinked, new_symbol() may revive it */
     }
     if (firstprot) {
       /* add protected symbols to the list again */
       lastprot->next = first_symbol;
       first_symbol = firstprot;
     }
-    saved_symbol = NULL;
+    dead_gens[cur_gen>>3] |= 1 << (cur_gen&7);
   }
+  cur_gen = 0;
+  tentative = 0;
+  dead_hit = NULL;
+}
+
+
+void protect_symbol(symbol *sym)
+/* the symbol survives a restore_symbols() */
+{
+  sym->flags |= PROTECTED;
+  if (sym->gen!=0 && sym->gen==cur_gen)
+    new_protected = 1;
 }
 
 
@@ -178,7 +391,7 @@ char *set_last_global_label(char *name)
 {
   char *prevlgl = last_global_label;
 
-  last_global_label = name;
+  enter_scope(intern_name(name));
   return prevlgl;
 }
 
@@ -191,17 +404,36 @@ int is_local_label(char *name)
 
 
 char *make_local_label(char *glob,int glen,char *loc,int llen)
-/* construct a local label of the form:
-   " " + global_label_name + " " + local_label_name */
+/* return a local label of the form:
+   " " + global_label_name + " " + local_label_name
+   The name is from the identifier pool and must not be freed. */
 {
+  char buf[128];
   char *name,*p;
+  hashdata data;
+  scope *sc;
 
   if (glen == 0) {
     /* use the last defined global label */
+    sc = current_scope();
     glob = last_global_label;
-    glen = strlen(last_global_label);
+    glen = sc->len;
+  }
+  else
+    sc = find_scope(glob,glen,1);
+
+  if (find_namelen(sc->locals,loc,llen,&data)) {
+    /* reuse the name of a known symbol, when it matches exactly */
+    name = ((symbol *)data.ptr)->name;
+    if (!strncmp(name+1,glob,glen) && name[glen+1]==' ' &&
+        !strncmp(name+glen+2,loc,llen) && name[glen+llen+2]=='\0') {
+      last_local = name;
+      last_local_scope = sc;
+      return name;
+    }
   }
-  p = name = mymalloc(llen+glen+3);
+
+  p = name = llen+glen+3<=sizeof(buf) ? buf : mymalloc(llen+glen+3);
   *p++ = ' ';
   if (glen) {
     memcpy(p,glob,glen);
@@ -209,8 +441,12 @@ char *make_local_label(char *glob,int glen,char *loc,int llen)
   }
   *p++ = ' ';
   memcpy(p,loc,llen);
-  *(p + llen) = '\0';
-  return name;
+  p = intern_namelen(name,llen+glen+2);
+  if (name != buf)
+    myfree(name);
+  last_local = p;
+  last_local_scope = sc;
+  return p;
 }
 
 
@@ -227,17 +463,16 @@ symbol *new_abs(char *name,expr *tree)
     add=0;
   }
   else {
-    new = mymalloc(sizeof(*new));
-    new->name = mystrdup(name);
+    new = new_symbol(name);
     add = 1;
   }
 
   new->type = EXPRESSION;
   new->sec = 0;
   new->expr = tree;
+  define_epoch++;
 
   if (add) {
-    add_symbol(new);
     new->flags = 0;
     new->size = 0;
     new->align = 0;
@@ -264,15 +499,13 @@ symbol *new_import(char *name)
   if (new)
     return new;
 
-  new = mymalloc(sizeof(*new));
+  new = new_symbol(name);
   new->type = IMPORT;
   new->flags = 0;
-  new->name = mystrdup(name);
   new->sec = 0;
   new->pc = 0;
   new->size = 0;
   new->align = 0;
-  add_symbol(new);
   return new;
 }
 
@@ -285,7 +518,7 @@ symbol *new_labsym(section *sec,char *name)
   if (chklabels) {
     hashdata data;
 
-    if (find_name_nc(mnemohash,name,&data))
+    if (find_mnemonic(name,strlen(name),1) >= 0)
       general_error(39);  /* name conflicts with mnemonic */
     else if (find_name_nc(dirhash,name,&data))
       general_error(40);  /* name conflicts with directive */
@@ -307,19 +540,18 @@ symbol *new_labsym(section *sec,char *name)
   if (new = find_symbol(name)) {
     if (new->type!=IMPORT) {
       symbol *old = new;
+      uint32_t h;
 
-      new = mymalloc(sizeof(*new));
+      new = alloc_symbol();
+      h = new->handle;
       *new = *old;
+      new->handle = h;
       general_error(5,name);
     }
     add = 0;
   }
   else {
-    new = mymalloc(sizeof(*new));
-    if (sec->flags&LABELS_ARE_LOCAL)
-      new->name = name;
-    else
-      new->name = mystrdup(name);
+    new = new_symbol(name);
     add = 1;
   }
 
@@ -328,14 +560,13 @@ symbol *new_labsym(section *sec,char *name)
   new->pc = sec->pc;
 
   if (add) {
-    add_symbol(new);
     new->flags = 0;
     new->size = 0;
     new->align = 0;
   }
 
   if (*name != ' ')
-    last_global_label = new->name;
+    enter_scope(new->name);
 
   if (sec->flags & ABSOLUTE)
     new->flags |= ABSLABEL;
@@ -381,12 +612,80 @@ expr *set_internal_abs(char *name,taddr newval)
   if (oldexpr == NULL)
     ierror(0);
   eval_expr(oldexpr,&oldval,NULL,0);
-  if (newval != oldval)
+  if (newval != oldval) {
     sym->expr = number_expr(newval);
+    define_epoch++;
+  }
   return oldexpr;
 }
 
 
+int symbol_binding(symbol *sym)
+{
+  if (sym->flags & VASMINTERN)
+    return SYMB_INTERN;
+  if (sym->flags & WEAK)
+    return SYMB_WEAK;
+  if (sym->type == IMPORT)
+    return (sym->flags & COMMON) ? SYMB_COMMON : SYMB_IMPORT;
+  return (sym->flags & EXPORT) ? SYMB_GLOBAL : SYMB_LOCAL;
+}
+
+
+exportidx *build_exportidx(symbol *first)
+/* classify all symbols in one pass over the list */
+{
+  exportidx *x = mycalloc(sizeof(exportidx));
+  size_t pos[SYMB_NUM];
+  symbol *sym;
+  size_t i;
+  int b;
+
+  for (sym=first; sym; sym=sym->next)
+    x->nsyms++;
+  x->syms = mymalloc((x->nsyms+1)*sizeof(symbol *));
+  x->bybind = mymalloc((x->nsyms+1)*sizeof(symbol *));
+  x->bind = mymalloc(x->nsyms+1);
+
+  for (i=0,sym=first; sym; sym=sym->next,i++) {
+    x->syms[i] = sym;
+    b = x->bind[i] = symbol_binding(sym);
+    x->first[b+1]++;
+  }
+  for (b=0; b<SYMB_NUM; b++) {
+    pos[b] = x->first[b];
+    x->first[b+1] += x->first[b];
+  }
+  for (i=0; i<x->nsyms; i++)
+    x->bybind[pos[x->bind[i]]++] = x->syms[i];
+  return x;
+}
+
+
+void free_exportidx(exportidx *x)
+{
+  if (x) {
+    myfree(x->syms);
+    myfree(x->bybind);
+    myfree(x->bind);
+    myfree(x);
+  }
+}
+
+
+void print_symhashstats(FILE *f)
+{
+  if (symhash)
+    print_hashstats(f,symhash,"symbol");
+  if (scopehash)
+    print_hashstats(f,scopehash,"local label scope");
+#ifdef HAVE_REGSYMS
+  if (regsymhash)
+    print_hashstats(f,regsymhash,"register symbol");
+#endif
+}
+
+
 #ifdef HAVE_REGSYMS
 void add_regsym(regsym *rsym)
 {
@@ -432,7 +731,7 @@ regsym *new_regsym(int redef,int no_case,char *name,int type,
 
   if (rsym == NULL) {
     rsym = mymalloc(sizeof(regsym));
-    rsym->reg_name = mystrdup(name);
+    rsym->reg_name = intern_name(name);
     rsym->reg_type = type;
     rsym->reg_flags = flags;
     rsym->reg_num = num;
@@ -476,6 +775,7 @@ int undef_regsym(char *name,int no_case,int type)
 int init_symbol(void)
 {
   symhash = new_hashtable(SYMHTABSIZE);
+  scopehash = new_hashtable(0);
 #ifdef HAVE_REGSYMS
   regsymhash = new_hashtable(REGSYMHTSIZE);
 #endif
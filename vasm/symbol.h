@@ -31,26 +31,51 @@
 #define REGLIST (1<<13)
 #define USED (1<<14)        /* used in any expression */
 #define NEAR (1<<15)        /* may refer symbol with near addressing modes */
+#define XSECDEP (1<<16)     /* sizes of another section depend on it */
 #define RSRVD_S (1L<<24)    /* bits 24..27 are reserved for syntax modules */
 #define RSRVD_O (1L<<28)    /* bits 28..31 are reserved for output modules */
 
+/* The fields used while resolving come first. Symbols are allocated
+   by alloc_symbol() and can be addressed by a 32-bit handle. */
 struct symbol {
   struct symbol *next;
+  section *sec;
+  taddr pc;
   int type;
   uint32_t flags;
   char *name;
   expr *expr;
   expr *size;
-  section *sec;
-  taddr pc;
   taddr align;
   unsigned long idx; /* usable by output module */
+  uint32_t gen;      /* generation of a tentative parse, see symbol.c */
+  uint32_t handle;   /* index in the symbol pool */
 };
 
 /* type of symbol references */
 #define LOCREF(symp) ((symp)->type==LABSYM&&!((symp)->flags&WEAK))
 #define EXTREF(symp) ((symp)->type==IMPORT||((symp)->flags&WEAK))
 
+/* binding classes of the export index */
+#define SYMB_LOCAL  0       /* defined, not exported */
+#define SYMB_GLOBAL 1       /* defined and exported */
+#define SYMB_WEAK   2       /* defined or imported weak symbol */
+#define SYMB_COMMON 3       /* common symbol (an import) */
+#define SYMB_IMPORT 4       /* other imports */
+#define SYMB_INTERN 5       /* vasm-internal symbols */
+#define SYMB_NUM    6
+#define SYMBIT(b) (1<<(b))
+
+/* Index of all symbols for the output modules, built once after
+   fix_labels(). Both arrays keep the order of the symbol list. */
+typedef struct exportidx {
+  size_t nsyms;
+  symbol **syms;          /* all symbols */
+  unsigned char *bind;    /* binding class of syms[i] */
+  symbol **bybind;        /* all symbols, partitioned by binding class */
+  size_t first[SYMB_NUM+1]; /* class b is bybind[first[b]..first[b+1]-1] */
+} exportidx;
+
 
 #ifdef HAVE_REGSYMS
 /* register symbols */
@@ -67,11 +92,18 @@ extern symbol *first_symbol;
 
 void print_symbol(FILE *,symbol *);
 char *get_bind_name(symbol *);
+symbol *alloc_symbol(void);
+symbol *symbol_ptr(uint32_t);
 void add_symbol(symbol *);
 symbol *find_symbol(char *);
 void refer_symbol(symbol *,char *);
 void save_symbols(void);
 void restore_symbols(void);
+void protect_symbol(symbol *);
+void print_symhashstats(FILE *);
+int symbol_binding(symbol *);
+exportidx *build_exportidx(symbol *);
+void free_exportidx(exportidx *);
 
 int check_symbol(char *);
 char *set_last_global_label(char *);
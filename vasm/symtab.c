@@ -3,99 +3,266 @@
 
 #include "vasm.h"
 
+/* The tables use open addressing with linear probing. They start small
+   and double their size whenever the load factor exceeds 3/4. */
+#define HTMINSIZE 16
+#define HTFULL(ht) ((ht)->used >= ((ht)->size>>1)+((ht)->size>>2))
+
+
 hashtable *new_hashtable(size_t size)
 {
   hashtable *new = mymalloc(sizeof(*new));
+  size_t n = HTMINSIZE;
 
-  new->size = size;
+  while (n < size)
+    n <<= 1;
+  new->size = n;
+  new->used = 0;
   new->collisions = 0;
-  new->entries = mycalloc(size*sizeof(*new->entries));
+  new->entries = mycalloc(n*sizeof(*new->entries));
   return new;
 }
 
-size_t hashcode(char *name)
+/* The hash function reads 8 characters at once. Upper case characters in
+   a word are folded for the case-insensitive versions, so hashcode_nc(s)
+   is identical to hashcode(s) for a lower case s. */
+#define HASHMUL 0x9e3779b97f4a7c15ULL
+#define ONEBYTES 0x0101010101010101ULL
+#define HIGHBITS 0x8080808080808080ULL
+#define ROTL64(x,n) (((x)<<(n))|((x)>>(64-(n))))
+
+static uint64_t fold_word(uint64_t w)
+/* convert all ASCII upper case characters in a word to lower case */
 {
-  size_t h = 5381;
-  int c;
+  uint64_t b = w & ~HIGHBITS;
+  uint64_t upper = (b + (0x80-'A')*ONEBYTES) ^ (b + (0x80-'Z'-1)*ONEBYTES);
+
+  return w | ((upper & ~w & HIGHBITS) >> 2);
+}
 
-  while (c = (unsigned char)*name++)
-    h = ((h << 5) + h) + c;
-  return h;
+static size_t hash_final(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return (size_t)h;
 }
 
 size_t hashcodelen(char *name,int len)
 {
-  size_t h = 5381;
+  uint64_t h = (uint64_t)len * HASHMUL;
+  uint64_t w;
+
+  for (; len >= 8; len -= 8, name += 8) {
+    memcpy(&w,name,8);
+    h = (ROTL64(h,5) ^ w) * HASHMUL;
+  }
+  if (len > 0) {
+    w = 0;
+    memcpy(&w,name,len);
+    h = (ROTL64(h,5) ^ w) * HASHMUL;
+  }
+  return hash_final(h);
+}
+
+size_t hashcodelen_nc(char *name,int len)
+{
+  uint64_t h = (uint64_t)len * HASHMUL;
+  uint64_t w;
+
+  for (; len >= 8; len -= 8, name += 8) {
+    memcpy(&w,name,8);
+    h = (ROTL64(h,5) ^ fold_word(w)) * HASHMUL;
+  }
+  if (len > 0) {
+    w = 0;
+    memcpy(&w,name,len);
+    h = (ROTL64(h,5) ^ fold_word(w)) * HASHMUL;
+  }
+  return hash_final(h);
+}
+
+/* Copy len characters of name to buf and fold them to lower case.
+   Returns non-zero when there was any upper case character. */
+static int fold_name(char *buf,char *name,int len)
+{
+  uint64_t w,f,changed=0;
+  int n;
+
+  for (n=0; n<len; n+=8) {
+    int k = len-n < 8 ? len-n : 8;
 
-  while (len--)
-    h = ((h << 5) + h) + (unsigned char)*name++;
-  return h;
+    w = 0;
+    memcpy(&w,name+n,k);
+    f = fold_word(w);
+    changed |= f ^ w;
+    memcpy(buf+n,&f,k);
+  }
+  buf[len] = 0;
+  return changed != 0;
+}
+
+size_t hashcode(char *name)
+{
+  return hashcodelen(name,strlen(name));
 }
 
 size_t hashcode_nc(char *name)
 {
-  size_t h = 5381;
-  int c;
+  return hashcodelen_nc(name,strlen(name));
+}
+
+/* longer names are folded in an allocated buffer */
+#define FOLDBUFSIZE 128
+
+/* return the lower case version of name, which is name itself when
+   there are no upper case characters */
+static char *fold_key(char *name)
+{
+  char buf[FOLDBUFSIZE];
+  int len=strlen(name);
+  char *p=len<FOLDBUFSIZE?buf:mymalloc(len+1);
 
-  while (c = (unsigned char)*name++)
-    h = ((h << 5) + h) + tolower(c);
-  return h;
+  if(fold_name(p,name,len))
+    name=intern_namelen(p,len);
+  if(p!=buf)
+    myfree(p);
+  return name;
 }
 
-size_t hashcodelen_nc(char *name,int len)
+/* insert entry at the first free slot of its probe sequence */
+static void put_hashentry(hashtable *ht,hashentry *e)
 {
-  size_t h = 5381;
+  size_t mask=ht->size-1;
+  size_t i=e->hash&mask;
+
+  while(ht->entries[i].name)
+    i=(i+1)&mask;
+  ht->entries[i]=*e;
+}
 
-  while (len--)
-    h = ((h << 5) + h) + tolower((unsigned char)*name++);
-  return h;
+void free_hashtable(hashtable *ht)
+{
+  myfree(ht->entries);
+  myfree(ht);
 }
 
-/* add to hashtable; name must be unique */
+/* double the size of a hashtable */
+static void grow_hashtable(hashtable *ht)
+{
+  hashentry *old=ht->entries;
+  size_t oldsize=ht->size;
+  size_t i,j,n;
+
+  ht->size=oldsize<<1;
+  ht->entries=mycalloc(ht->size*sizeof(*ht->entries));
+  /* Start rehashing behind a free slot, so no probe sequence wraps around
+     and entries with identical names keep their order. */
+  for(j=0;old[j].name;j++);
+  for(n=0;n<oldsize;n++){
+    i=(j+n)&(oldsize-1);
+    if(old[i].name)
+      put_hashentry(ht,&old[i]);
+  }
+  myfree(old);
+}
+
+/* remove entry from slot i, move following entries up to close the gap */
+static void del_hashentry(hashtable *ht,size_t i)
+{
+  hashentry *e=ht->entries;
+  size_t mask=ht->size-1;
+  size_t j=i,k;
+
+  for(;;){
+    j=(j+1)&mask;
+    if(!e[j].name)
+      break;
+    k=e[j].hash&mask;
+    /* entry j must stay, when its home slot k is cyclically in ]i,j] */
+    if(i<=j?(i<k&&k<=j):(i<k||k<=j))
+      continue;
+    e[i]=e[j];
+    i=j;
+  }
+  e[i].name=NULL;
+  ht->used--;
+}
+
+/* add to hashtable; name should be unique, otherwise the new entry
+   hides the old one until it is removed again */
 void add_hashentry(hashtable *ht,char *name,hashdata data)
 {
-  size_t i=nocase?(hashcode_nc(name)%ht->size):(hashcode(name)%ht->size);
-  hashentry *new=mymalloc(sizeof(*new));
-  new->name=name;
-  new->data=data;
-  if(debug){
-    if(ht->entries[i])
+  hashentry new,tmp,*p;
+  size_t mask,i;
+
+  if(HTFULL(ht))
+    grow_hashtable(ht);
+  mask=ht->size-1;
+  new.name=name;
+  new.key=nocase?fold_key(name):name;
+  new.data=data;
+  new.hash=hashcode(new.key);
+  for(i=new.hash&mask;(p=&ht->entries[i])->name;i=(i+1)&mask){
+    if(p->hash==new.hash&&
+       (!strcmp(new.name,p->name)||(nocase&&!strcmp(new.key,p->key)))){
+      /* same name: newer entry goes first, move older one down */
+      tmp=*p;
+      *p=new;
+      new=tmp;
+    }
+    else if(debug)
       ht->collisions++;
   }
-  new->next=ht->entries[i];
-  ht->entries[i]=new;
+  *p=new;
+  ht->used++;
 }
 
 /* remove from hashtable; name must be unique */
 void rem_hashentry(hashtable *ht,char *name,int no_case)
 {
-  size_t i=no_case?(hashcode_nc(name)%ht->size):(hashcode(name)%ht->size);
-  hashentry *p,*last;
-
-  for(p=ht->entries[i],last=NULL;p;p=p->next){
-    if(!strcmp(name,p->name)||(no_case&&!stricmp(name,p->name))){
-      if(last==NULL)
-        ht->entries[i]=p->next;
-      else
-        last->next=p->next;
-      myfree(p);
-      return;
+  char buf[FOLDBUFSIZE];
+  int len=strlen(name);
+  char *key=buf;
+  size_t mask=ht->size-1;
+  size_t h,i;
+  hashentry *p;
+  int found=0;
+
+  if(no_case){
+    if(len>=FOLDBUFSIZE)
+      key=mymalloc(len+1);
+    fold_name(key,name,len);
+  }else
+    key=name;
+  h=hashcode(key);
+  for(i=h&mask;(p=&ht->entries[i])->name;i=(i+1)&mask){
+    if(p->hash==h&&(p->name==name||!strcmp(name,p->name)||
+                    (no_case&&!strcmp(key,p->key)))){
+      del_hashentry(ht,i);
+      found=1;
+      break;
     }
-    last=p;
   }
-  ierror(0);
+  if(key!=buf&&key!=name)
+    myfree(key);
+  if(!found)
+    ierror(0);
 }
 
+
 /* finds unique entry in hashtable */
 int find_name(hashtable *ht,char *name,hashdata *result)
 {
   if(nocase)
     return find_name_nc(ht,name,result);
   else{
-    size_t i=hashcode(name)%ht->size;
+    size_t h=hashcode(name);
+    size_t mask=ht->size-1;
+    size_t i;
     hashentry *p;
-    for(p=ht->entries[i];p;p=p->next){
-      if(!strcmp(name,p->name)){
+    for(i=h&mask;(p=&ht->entries[i])->name;i=(i+1)&mask){
+      if(p->hash==h&&(p->name==name||!strcmp(name,p->name))){
         *result=p->data;
         return 1;
       }else
@@ -111,10 +278,12 @@ int find_namelen(hashtable *ht,char *name,int len,hashdata *result)
   if(nocase)
     return find_namelen_nc(ht,name,len,result);
   else{
-    size_t i=hashcodelen(name,len)%ht->size;
+    size_t h=hashcodelen(name,len);
+    size_t mask=ht->size-1;
+    size_t i;
     hashentry *p;
-    for(p=ht->entries[i];p;p=p->next){
-      if(!strncmp(name,p->name,len)&&p->name[len]==0){
+    for(i=h&mask;(p=&ht->entries[i])->name;i=(i+1)&mask){
+      if(p->hash==h&&!strncmp(name,p->name,len)&&p->name[len]==0){
         *result=p->data;
         return 1;
       }else
@@ -127,29 +296,147 @@ int find_namelen(hashtable *ht,char *name,int len,hashdata *result)
 /* finds unique entry in hashtable - case insensitive */
 int find_name_nc(hashtable *ht,char *name,hashdata *result)
 {
-  size_t i=hashcode_nc(name)%ht->size;
-  hashentry *p;
-  for(p=ht->entries[i];p;p=p->next){
-    if(!stricmp(name,p->name)){
-      *result=p->data;
-      return 1;
-    }else
-      ht->collisions++;
-  }
-  return 0;
+  return find_namelen_nc(ht,name,strlen(name),result);
 }
 
-/* same as above, but uses len instead of zero-terminated string */
+/* same as above, but uses len instead of zero-terminated string;
+   the name is folded once, then compared with the folded keys */
 int find_namelen_nc(hashtable *ht,char *name,int len,hashdata *result)
 {
-  size_t i=hashcodelen_nc(name,len)%ht->size;
+  char buf[FOLDBUFSIZE];
+  char *key=len<FOLDBUFSIZE?buf:mymalloc(len+1);
+  size_t mask=ht->size-1;
+  size_t h,i;
   hashentry *p;
-  for(p=ht->entries[i];p;p=p->next){
-    if(!strnicmp(name,p->name,len)&&p->name[len]==0){
+  int found=0;
+
+  fold_name(key,name,len);
+  h=hashcodelen(key,len);
+  for(i=h&mask;(p=&ht->entries[i])->name;i=(i+1)&mask){
+    if(p->hash==h&&!strncmp(key,p->key,len)&&p->key[len]==0){
       *result=p->data;
-      return 1;
+      found=1;
+      break;
     }else
       ht->collisions++;
   }
-  return 0;
+  if(key!=buf)
+    myfree(key);
+  return found;
+}
+
+
+/* Identifier pool. Symbol, section and macro names are interned here,
+   so equal identifiers share a single copy, which stays valid until
+   free_interned() releases all of them at once. A name from the pool
+   compares equal to another pooled name by pointer. */
+#define POOLBLKSIZE 0x10000
+#define POOLHTABSIZE 0x1000
+
+struct poolblk {
+  struct poolblk *next;
+  size_t free;
+  char data[1];
+};
+
+static struct poolblk *poolblks;
+static hashtable *poolhash;
+static size_t poolbytes;
+
+
+static char *pool_alloc(size_t n)
+{
+  struct poolblk *b=poolblks;
+
+  if(!b||b->free<n){
+    size_t sz=n>POOLBLKSIZE?n:POOLBLKSIZE;
+    b=mymalloc(sizeof(struct poolblk)+sz);
+    b->free=sz;
+    if(n>POOLBLKSIZE&&poolblks){
+      /* keep using the current block for the next small names */
+      b->next=poolblks->next;
+      poolblks->next=b;
+    }else{
+      b->next=poolblks;
+      poolblks=b;
+    }
+  }
+  b->free-=n;
+  poolbytes+=n;
+  return b->data+b->free;
+}
+
+/* return the pooled copy of a name with len characters */
+char *intern_namelen(char *name,int len)
+{
+  hashentry new,*p;
+  size_t mask,i;
+
+  if(!poolhash)
+    poolhash=new_hashtable(POOLHTABSIZE);
+  new.hash=hashcodelen(name,len);
+  mask=poolhash->size-1;
+  for(i=new.hash&mask;(p=&poolhash->entries[i])->name;i=(i+1)&mask){
+    if(p->hash==new.hash&&!memcmp(name,p->name,len)&&p->name[len]==0)
+      return p->name;
+  }
+  new.name=new.key=pool_alloc(len+1);
+  memcpy(new.name,name,len);
+  new.name[len]=0;
+  new.data.ptr=NULL;
+  if(HTFULL(poolhash))
+    grow_hashtable(poolhash);
+  put_hashentry(poolhash,&new);
+  poolhash->used++;
+  return new.name;
+}
+
+char *intern_name(char *name)
+{
+  return intern_namelen(name,strlen(name));
+}
+
+/* release all pooled names */
+void free_interned(void)
+{
+  struct poolblk *b;
+
+  while(b=poolblks){
+    poolblks=b->next;
+    myfree(b);
+  }
+  if(poolhash){
+    free_hashtable(poolhash);
+    poolhash=NULL;
+  }
+  poolbytes=0;
+}
+
+void print_internstats(FILE *f)
+{
+  if(poolhash){
+    print_hashstats(f,poolhash,"identifier");
+    fprintf(f,"identifier pool: %lu bytes\n",(unsigned long)poolbytes);
+  }
+}
+
+/* print number of entries and average/maximum length of the probe
+   sequences, to check the quality of the hash function */
+void print_hashstats(FILE *f,hashtable *ht,char *name)
+{
+  size_t mask=ht->size-1;
+  size_t i,n,sum=0,max=0;
+
+  for(i=0;i<ht->size;i++){
+    if(ht->entries[i].name){
+      n=((i-(ht->entries[i].hash&mask))&mask)+1;
+      sum+=n;
+      if(n>max)
+        max=n;
+    }
+  }
+  fprintf(f,"%s hashtable: %lu entries, size %lu, "
+          "chain length avg %.2f, max %lu\n",name,(unsigned long)ht->used,
+          (unsigned long)ht->size,ht->used?(double)sum/ht->used:0.0,
+          (unsigned long)max);
 }
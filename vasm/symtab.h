@@ -8,19 +8,27 @@ typedef union hashdata {
   uint32_t idx;
 } hashdata;
 
+/* Entries are stored inline in an open-addressing table. An unused slot
+   has name==NULL. The full hash code is kept to avoid most string
+   comparisons and to allow rehashing without touching the names.
+   key is the name folded to lower case in nocase mode, otherwise the
+   name itself. */
 typedef struct hashentry {
   char *name;
+  char *key;
   hashdata data;
-  struct hashentry *next;
+  size_t hash;
 } hashentry;
 
 typedef struct hashtable {
-  hashentry **entries;
-  size_t size;
+  hashentry *entries;
+  size_t size;          /* always a power of 2 */
+  size_t used;
   int collisions;
 } hashtable;
 
 hashtable *new_hashtable(size_t);
+void free_hashtable(hashtable *);
 size_t hashcode(char *);
 size_t hashcodelen(char *,int);
 size_t hashcode_nc(char *);
@@ -31,3 +39,8 @@ int find_name(hashtable *,char *,hashdata *);
 int find_namelen(hashtable *,char *,int,hashdata *);
 int find_name_nc(hashtable *,char *,hashdata *);
 int find_namelen_nc(hashtable *,char *,int,hashdata *);
+void print_hashstats(FILE *,hashtable *,char *);
+char *intern_name(char *);
+char *intern_namelen(char *,int);
+void free_interned(void);
+void print_internstats(FILE *);
@@ -10,5 +10,8 @@
 /* result of a boolean operation */
 #define BOOLEAN(x) (x)
 
+/* local labels are only visible behind the last global label */
+#define CLOSE_LOCAL_SCOPES
+
 /* overwrite macro defaults */
 #define MAXMACPARAMS 64
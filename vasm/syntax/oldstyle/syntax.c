@@ -1051,10 +1051,8 @@ static int execute_struct(char *name,int name_len,char *s)
         else if (p->type == SPACE) {
           /* parse the fill expression for this space */
           new = clone_atom(p);
-          new->content.sb = new_sblock(p->content.sb->space_exp,
-                                       p->content.sb->size,
-                                       parse_expr_tmplab(&opp));
-          new->content.sb->space = p->content.sb->space;
+          free_expr(new->content.sb->fill_exp);
+          new->content.sb->fill_exp = parse_expr_tmplab(&opp);
           add_atom(0,new);
         }
         else {
@@ -14,6 +14,9 @@ char *chkidend(char *,char *);
 /* result of a boolean operation */
 #define BOOLEAN(x) -(x)
 
+/* local labels are only visible behind the last global label */
+#define CLOSE_LOCAL_SCOPES
+
 #ifndef CPU_DEF_ALIGN
 #define CPU_DEF_ALIGN 2	 /* power2-alignment is default for .align */
 #endif
@@ -0,0 +1,6 @@
+; a failed operand parse must not keep symbols of the rolled back
+; attempt in the symbol list
+	section code,code
+	move.l	fwd,#3
+fwd:	nop
+	bra	fwd
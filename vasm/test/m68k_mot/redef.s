@@ -0,0 +1,4 @@
+; symbols created after a rolled back parse must not be dead
+	bra	lab\@
+lab:
+lab:
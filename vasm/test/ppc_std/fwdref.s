@@ -0,0 +1,5 @@
+# a failed operand parse must not keep symbols of the rolled back
+# attempt in the symbol list
+	lwz 3,fwd(3,4)
+fwd:	nop
+	b fwd
@@ -1,10 +1,14 @@
 /* tfloat.h Floating point type and string conversion function. */
 /* (c) 2014 Frank Wille */
 
+#include <float.h>
+
 #if defined(__VBCC__) || (defined(_MSC_VER) && _MSC_VER < 1800) || defined(__CYGWIN__)
 typedef double tfloat;
 #define strtotfloat(n,e) strtod(n,e)
+#define TFLOAT_MANT_DIG DBL_MANT_DIG
 #else
 typedef long double tfloat;
 #define strtotfloat(n,e) strtold(n,e)
+#define TFLOAT_MANT_DIG LDBL_MANT_DIG
 #endif
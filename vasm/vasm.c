@@ -3,9 +3,11 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "vasm.h"
 #include "stabs.h"
+#include "phash.h"
 
 #define _VER "vasm 1.8b"
 char *copyright = _VER " (c) in 2002-2017 Volker Barthelmann";
@@ -20,10 +22,106 @@ static const char *_ver = "$VER: " _VER " " __AMIGADATE__ "\r\n";
    hopefully will never happen.
    During the first FASTOPTPHASE passes all instructions of a section will be
    optimized at the same time. After that the resolver enters a safe mode,
-   where only a single instruction per pass is changed. */
+   where only a single instruction per pass is changed.
+   With -relax=grow all atoms are still sized in every pass after the fast
+   phase, but with the RESOLVE_WARN flag set, so a backend will only let
+   them grow. This is also done when assembling the section. The resolver
+   converges, when no atom can become larger any more. The statistics show
+   by how many bytes the section has grown after the fast phase. */
 #define MAXPASSES 1000
 #define FASTOPTPHASE 200
 
+/* The size of an instruction, space or roffs atom depends on its pc and
+   on the labels it refers to. While sizing such an atom, eval_expr()
+   reports these labels via add_symdep() and the resolver remembers their
+   values. The atom is not sized again, as long as neither its pc nor any
+   of the labels changed. Dependencies are only kept when sizing confirmed
+   the atom's previous size, so a backend's state (like the last size of
+   an instruction) has settled as well.
+   A backend may relax the dependency on a label with add_symrange(), when
+   the size only changes at the borders of a range, like a branch, which
+   becomes longer when its distance no longer fits into 8 bits. Such an
+   atom is kept as long as all ranges stay on the same side of their
+   borders, even when its pc has changed. */
+#define MAXSYMDEPS 16
+#define DEPS_UNKNOWN (~0U)
+typedef struct sizedep {
+  taddr pc;
+  size_t first;         /* index of the first label in symdeps[] */
+  unsigned cnt;         /* number of labels, or DEPS_UNKNOWN */
+  int pass;             /* pass, which recorded them */
+  int ranged;           /* pc only matters for the ranges */
+} sizedep;
+struct symdep {
+  symbol *sym;
+  taddr pc;             /* value of the label, when the atom was sized */
+  taddr addend,lo,hi;   /* range for label+addend, with SD_RANGE */
+  int flags;
+};
+#define SD_RANGE 1
+#define SD_PCREL 2      /* range for label+addend-pc */
+#define SD_INSIDE 4     /* value was inside lo..hi */
+int record_symdeps;
+static struct symdep *symdeps[2];  /* previous and current pass */
+static size_t nsymdeps[2],maxsymdeps[2];
+static int cur_deps,cur_pass;
+static size_t depstart;
+static int depoverflow,depranged,depcurpc;
+static taddr deppc;
+
+/* Labels of other sections, which the sizes of a section depend on. A
+   section is resolved again, when one of them has moved afterwards. */
+typedef struct xsecdep {
+  section *sec;
+  symbol *sym;
+  taddr pc;
+} xsecdep;
+static xsecdep *xsecdeps;
+static size_t nxsecdeps,maxxsecdeps;
+static section *depsec;  /* section being resolved */
+
+/* statistics of each resolve_section(), for -resolve-stats */
+#define STATS_TOPN 10
+typedef struct passstat {
+  int fast;
+  unsigned long resized,moved;
+  clock_t time;
+} passstat;
+typedef struct secstat {
+  struct secstat *next;
+  section *sec;
+  int passes,fastpasses;
+  passstat *pass;
+  atom *top[STATS_TOPN];  /* atoms with the most size changes */
+  int ntop;
+} secstat;
+static secstat *first_secstat,*last_secstat;
+
+/* Once an instruction has changed its size in safe mode, the remaining
+   instructions keep their sizes for this pass, and everything behind
+   just moves by the same offset. Only labels and atoms, which are not
+   of a fixed size (anchors), are visited then. The pc in front of the
+   next anchor is its pc from the previous pass plus the offset, as long
+   as the offset is a multiple of the alignments of the atoms skipped,
+   so none of their paddings can change. */
+#define MAXFIXALIGN 0x10000UL
+typedef struct anchor {
+  atom *atom;
+  size_t idx;           /* index of the atom in its section */
+  taddr inpc,outpc;     /* pc before and after the atom in the last pass */
+} anchor;
+
+/* Runs of atoms with a stable size (see add_atom()) are stepped over as a
+   whole. Their total size, including paddings, stays the same for any pc
+   with the same offset to a common multiple of their alignments. */
+typedef struct span {
+  size_t idx,n;         /* index of the first atom, number of atoms */
+  atom *next;           /* first atom behind the span */
+  taddr align;          /* common multiple of the alignments, or 0 */
+  taddr inpc;           /* pc in front of the span, when size was computed */
+  taddr size;           /* size of the span, or -1 when unknown */
+} span;
+
 source *cur_src=NULL;
 char *filename,*debug_filename;
 section *current_section;
@@ -53,6 +151,10 @@ static int *listtitlelines;
 static int listtitlecnt;
 
 static FILE *outfile=NULL;
+static int stream_output,streaming;
+
+int (*start_stream)(FILE *,section *,symbol *);
+void (*stream_section)(FILE *,section *);
 
 static int depend,depend_all;
 #define DEPEND_LIST     1
@@ -68,18 +170,17 @@ static section *first_section,*last_section;
 static section *prev_sec=NULL,*prev_org=NULL;
 #endif
 
-/* MNEMOHTABSIZE should be defined by cpu module */
-#ifndef MNEMOHTABSIZE
-#define MNEMOHTABSIZE 0x1000
-#endif
-hashtable *mnemohash;
+static hashtable *mnemohash;  /* without a generated perfect hash */
+static char *mnemo_removed;
 
-static int verbose=1,auto_import=1;
+static int verbose=1,auto_import=1,relax_grow;
+static char *cachename;
+static int resolve_stats;  /* 1: text, 2: JSON */
 static struct include_path *first_incpath=NULL;
 static struct include_path *first_source=NULL;
 
 static char *output_copyright;
-static void (*write_object)(FILE *,section *,symbol *);
+static void (*write_object)(FILE *,section *,symbol *,exportidx *);
 static int (*output_args)(char *);
 
 
@@ -104,7 +205,10 @@ void leave(void)
       print_symbol(stdout,sym);
       fprintf(stdout,"\n");
     }
+    print_symhashstats(stdout);
+    print_internstats(stdout);
   }
+  free_interned();
 
   if(errors)
     exit(EXIT_FAILURE);
@@ -124,6 +228,7 @@ static void convert_offset_labels(void)
       sym->sec = NULL;
     }
   }
+  layout_epoch++;
 }
 
 /* Removes all unallocated (offset) sections from the list. */
@@ -172,14 +277,321 @@ static void new_stabdef(aoutnlist *nlist,section *sec)
 }
 
 
+static void *need_room(void *a,size_t *max,size_t n,size_t size)
+/* make sure that array a has room for n elements */
+{
+  if(n>*max){
+    while(n>*max)
+      *max=*max?2**max:0x100;
+    a=myrealloc(a,*max*size);
+  }
+  return a;
+}
+
+static struct symdep *new_symdeps(size_t n)
+{
+  size_t cnt=nsymdeps[cur_deps];
+
+  if(cnt+n>maxsymdeps[cur_deps]){
+    maxsymdeps[cur_deps]=maxsymdeps[cur_deps]?2*maxsymdeps[cur_deps]:0x1000;
+    symdeps[cur_deps]=myrealloc(symdeps[cur_deps],
+                                maxsymdeps[cur_deps]*sizeof(struct symdep));
+  }
+  nsymdeps[cur_deps]=cnt+n;
+  return symdeps[cur_deps]+cnt;
+}
+
+void add_symdep(symbol *sym)
+/* remember a label the current atom's size depends on,
+   NULL for the current pc */
+{
+  struct symdep *d=symdeps[cur_deps];
+  size_t i,n=nsymdeps[cur_deps];
+
+  if(sym==NULL){
+    depcurpc=1;
+    return;
+  }
+  if(sym->sec!=depsec&&!(sym->flags&XSECDEP)){
+    xsecdeps=need_room(xsecdeps,&maxxsecdeps,nxsecdeps+1,sizeof(xsecdep));
+    xsecdeps[nxsecdeps].sec=depsec;
+    xsecdeps[nxsecdeps].sym=sym;
+    xsecdeps[nxsecdeps++].pc=sym->pc;
+    sym->flags|=XSECDEP;
+  }
+  for(i=depstart;i<n;i++){
+    if(d[i].sym==sym)
+      return;
+  }
+  if(n-depstart>=MAXSYMDEPS){
+    depoverflow=1;
+    return;
+  }
+  d=new_symdeps(1);
+  d->sym=sym;
+  d->pc=sym->pc;
+  d->flags=0;
+}
+
+static int in_symrange(struct symdep *d,taddr pc)
+{
+  taddr v=d->sym->pc+d->addend;
+
+  if(d->flags&SD_PCREL)
+    v-=pc;
+  return v>=d->lo&&v<=d->hi;
+}
+
+void add_symrange(symbol *sym,taddr addend,taddr lo,taddr hi,int pcrel)
+/* The size of the current atom only changes when sym+addend (minus the
+   atom's pc, with pcrel) enters or leaves the range lo..hi. */
+{
+  struct symdep *d=symdeps[cur_deps];
+  size_t i,n=nsymdeps[cur_deps];
+
+  if(!record_symdeps)
+    return;
+  for(i=depstart;i<n;i++){
+    if(d[i].sym==sym){
+      d+=i;
+      if(d->flags&SD_RANGE)
+        break;  /* only one range per label */
+      d->addend=addend;
+      d->lo=lo;
+      d->hi=hi;
+      d->flags=SD_RANGE|(pcrel?SD_PCREL:0);
+      if(in_symrange(d,deppc))
+        d->flags|=SD_INSIDE;
+      depranged=1;
+      return;
+    }
+  }
+  /* not a label we depend on (the current pc), or a second range */
+  depcurpc=1;
+}
+
+static int keep_symdeps(sizedep *sd,taddr pc)
+/* Check that none of the labels has moved since the atom was sized, then
+   carry its dependencies over into the current pass. */
+{
+  struct symdep *d;
+  unsigned i;
+
+  if(sd->cnt==DEPS_UNKNOWN||sd->pass!=cur_pass-1||
+     (sd->pc!=pc&&!sd->ranged))
+    return 0;
+  d=symdeps[!cur_deps]+sd->first;
+  for(i=0;i<sd->cnt;i++){
+    if(d[i].flags&SD_RANGE){
+      if(in_symrange(&d[i],pc)!=((d[i].flags&SD_INSIDE)!=0))
+        return 0;
+    }
+    else if(d[i].sym->pc!=d[i].pc)
+      return 0;
+  }
+  sd->pc=pc;
+  sd->first=nsymdeps[cur_deps];
+  sd->pass=cur_pass;
+  if(sd->cnt)
+    memcpy(new_symdeps(sd->cnt),d,sd->cnt*sizeof(struct symdep));
+  return 1;
+}
+
+static size_t size_atom(atom *p,section *sec,sizedep *sd,int track)
+/* determine the atom's size and record its dependencies */
+{
+  unsigned long msgs=messages;
+  size_t size;
+
+  sd->cnt=DEPS_UNKNOWN;
+  sd->pass=cur_pass;
+  if(p->type!=INSTRUCTION&&p->type!=SPACE&&p->type!=ROFFS)
+    return atom_size(p,sec,sec->pc);
+  depstart=nsymdeps[cur_deps];
+  depoverflow=depranged=depcurpc=0;
+  deppc=sec->pc;
+  record_symdeps=1;
+  size=atom_size(p,sec,sec->pc);
+  record_symdeps=0;
+  if(track&&size==p->lastsize&&messages==msgs&&!depoverflow){
+    sd->pc=sec->pc;
+    sd->first=depstart;
+    sd->cnt=nsymdeps[cur_deps]-depstart;
+    sd->ranged=depranged&&!depcurpc;
+  }
+  else
+    nsymdeps[cur_deps]=depstart;
+  return size;
+}
+
+static taddr common_align(taddr m,taddr align)
+/* a common multiple of m and align, 0 when it becomes too large */
+{
+  unsigned long w;
+
+  if(m&&align>1&&m%align!=0){
+    /* taddr may be too small for MAXFIXALIGN (6502, 6800) */
+    if((unsigned long)m>MAXFIXALIGN/(unsigned long)align)
+      return 0;
+    w=(unsigned long)m*(unsigned long)align;
+    m=(taddr)w;
+    if(m<=0||(unsigned long)m!=w)
+      return 0;
+  }
+  return m;
+}
+
+static int fixed_size(atom *p)
+/* atoms, which keep their size in safe mode, once an instruction changed */
+{
+  if(p->flags&STABLE_SIZE)
+    return 1;
+  switch(p->type){
+    case INSTRUCTION:
+    case DATA:
+    case DATADEF:
+    case LINE:
+    case PRINTTEXT:
+    case PRINTEXPR:
+    case ASSERT:
+    case NLIST:
+      return 1;
+  }
+  return 0;
+}
+
+static secstat *new_secstat(section *sec)
+{
+  secstat *st=mymalloc(sizeof(secstat));
+
+  st->next=NULL;
+  st->sec=sec;
+  st->passes=st->fastpasses=st->ntop=0;
+  st->pass=NULL;
+  if(last_secstat)
+    last_secstat=last_secstat->next=st;
+  else
+    first_secstat=last_secstat=st;
+  return st;
+}
+
+static void find_top_atoms(secstat *st)
+/* remember the atoms with the most size changes, in descending order */
+{
+  atom *p;
+  int i;
+
+  for(p=st->sec->first;p;p=p->next){
+    if(p->changes==0||(st->ntop==STATS_TOPN&&
+                       p->changes<=st->top[STATS_TOPN-1]->changes))
+      continue;
+    i=st->ntop<STATS_TOPN?st->ntop++:STATS_TOPN-1;
+    for(;i>0&&st->top[i-1]->changes<p->changes;i--)
+      st->top[i]=st->top[i-1];
+    st->top[i]=p;
+  }
+}
+
+static void print_json_str(char *s)
+{
+  putchar('"');
+  for(;*s;s++){
+    if(*s=='"'||*s=='\\')
+      printf("\\%c",*s);
+    else if((unsigned char)*s<0x20)
+      printf("\\u%04x",(unsigned char)*s);
+    else
+      putchar(*s);
+  }
+  putchar('"');
+}
+
+static void print_resolve_stats(void)
+{
+  secstat *st;
+  passstat *ps;
+  atom *p;
+  int i;
+
+  if(resolve_stats==2)
+    printf("{\"sections\":[");
+  else
+    printf("\nresolve statistics:\n");
+  for(st=first_secstat;st;st=st->next){
+    if(resolve_stats==2){
+      printf("%s\n{\"name\":",st==first_secstat?"":",");
+      print_json_str(st->sec->name);
+      printf(",\"fast_passes\":%d,\"safe_passes\":%d,\"passes\":[",
+             st->fastpasses,st->passes-st->fastpasses);
+      for(i=0,ps=st->pass;i<st->passes;i++,ps++)
+        printf("%s\n {\"pass\":%d,\"fast\":%s,\"resized\":%lu,"
+               "\"moved\":%lu,\"ms\":%.3f}",i?",":"",i+1,
+               ps->fast?"true":"false",ps->resized,ps->moved,
+               ps->time*1000.0/CLOCKS_PER_SEC);
+      printf("],\n \"top_atoms\":[");
+      for(i=0;i<st->ntop;i++){
+        p=st->top[i];
+        printf("%s{\"file\":",i?",":"");
+        print_json_str(p->src?p->src->name:emptystr);
+        printf(",\"line\":%d,\"changes\":%u}",p->line,p->changes);
+      }
+      printf("]}");
+    }
+    else{
+      printf("section %s: %d fast, %d safe passes\n"
+             "   pass  mode   resized     moved        ms\n",
+             st->sec->name,st->fastpasses,st->passes-st->fastpasses);
+      for(i=0,ps=st->pass;i<st->passes;i++,ps++)
+        printf("%7d  %s %9lu %9lu %9.3f\n",i+1,ps->fast?"fast":"safe",
+               ps->resized,ps->moved,ps->time*1000.0/CLOCKS_PER_SEC);
+      if(st->ntop)
+        printf("   most size changes:\n");
+      for(i=0;i<st->ntop;i++){
+        p=st->top[i];
+        printf("%7u  %s line %d\n",p->changes,
+               p->src?p->src->name:emptystr,p->line);
+      }
+    }
+  }
+  if(resolve_stats==2)
+    printf("\n]}\n");
+}
+
 static void resolve_section(section *sec)
 {
-  taddr rorg_pc,org_pc;
+  taddr rorg_pc,org_pc,delta;
+  taddr fixalign=1;
   int fastphase=FASTOPTPHASE;
   int pass=0;
-  int extrapass;
-  size_t size;
-  atom *p;
+  int extrapass,track;
+  size_t size,nanchors,nspans,maxdeps,maxanchors,maxspans;
+  size_t i,a,s,nexti,maxpstats;
+  sizedep *deps;
+  anchor *anchors;
+  span *spans,*sp;
+  atom *p,*next;
+  secstat *st;
+  unsigned long resized,moved;
+  clock_t t0;
+
+  /* forget the labels of other sections from a previous resolve */
+  for(i=s=0;i<nxsecdeps;i++){
+    if(xsecdeps[i].sec!=sec)
+      xsecdeps[s++]=xsecdeps[i];
+  }
+  nxsecdeps=s;
+  depsec=sec;
+
+  /* the tables are built in the first pass, keeping room for an end marker */
+  nanchors=nspans=maxdeps=maxanchors=maxspans=0;
+  deps=NULL;
+  anchors=need_room(NULL,&maxanchors,1,sizeof(anchor));
+  anchors[0].atom=NULL;
+  spans=need_room(NULL,&maxspans,1,sizeof(span));
+  spans[0].idx=~(size_t)0;
+  sp=NULL;
+  st=resolve_stats?new_secstat(sec):NULL;
+  maxpstats=0;
 
   do{
     done=1;
@@ -188,12 +600,72 @@ static void resolve_section(section *sec)
       general_error(7,sec->name);
       break;
     }
+    resized=moved=0;
+    t0=st?clock():0;
     extrapass=pass<=fastphase;
     if(debug)
       printf("resolve_section(%s) pass %d%s",sec->name,pass,
              pass<=fastphase?" (fast)\n":"\n");
     sec->pc=sec->org;
-    for(p=sec->first;p;p=p->next){
+    cur_deps=pass&1;
+    cur_pass=pass;
+    nsymdeps[cur_deps]=0;
+#if HAVE_CPU_OPTS
+    /* cpu options in pass 1 may differ from the following passes */
+    track=pass>1;
+#else
+    track=1;
+#endif
+    for(i=a=s=0,p=sec->first;p;p=next,i=nexti){
+      if(pass==1){
+        deps=need_room(deps,&maxdeps,i+1,sizeof(sizedep));
+        deps[i].cnt=DEPS_UNKNOWN;
+        if(!fixed_size(p)){
+          anchors=need_room(anchors,&maxanchors,nanchors+2,sizeof(anchor));
+          anchors[nanchors].atom=p;
+          anchors[nanchors++].idx=i;
+          anchors[nanchors].atom=NULL;
+        }
+        else
+          fixalign=common_align(fixalign,p->align);
+        if(!(p->flags&STABLE_SIZE))
+          sp=NULL;
+        else if(sp){
+          sp->n++;
+          sp->align=common_align(sp->align,p->align);
+          sp->next=p->next;
+        }
+        else if(p->next&&(p->next->flags&STABLE_SIZE)){
+          spans=need_room(spans,&maxspans,nspans+2,sizeof(span));
+          sp=&spans[nspans++];
+          sp->idx=i;
+          sp->n=1;
+          sp->align=common_align(1,p->align);
+          sp->size=-1;
+          sp->next=p->next;
+          spans[nspans].idx=~(size_t)0;
+        }
+      }
+      else if(i==spans[s].idx){
+        sp=&spans[s++];
+        if(sp->size<0||sp->align==0||(sec->pc-sp->inpc)%sp->align!=0){
+          atom *q;
+          size_t n;
+          sp->inpc=sec->pc;
+          for(q=p,n=sp->n;n;q=q->next,n--)
+            sec->pc=pcalign(q,sec->pc)+q->lastsize;
+          sp->size=sec->pc-sp->inpc;
+        }
+        else
+          sec->pc+=sp->size;
+        next=sp->next;
+        nexti=i+sp->n;
+        continue;
+      }
+      next=p->next;
+      nexti=i+1;
+      if(p==anchors[a].atom)
+        anchors[a].inpc=sec->pc;
       sec->pc=pcalign(p,sec->pc);
       cur_src=p->src;
       cur_src->line=p->line;
@@ -226,56 +698,363 @@ static void resolve_section(section *sec)
                    (unsigned long)label->pc,(unsigned long)sec->pc);
           done=0;
           label->pc=sec->pc;
+          layout_epoch++;
+          moved++;
         }
       }
-      if(pass>fastphase&&!done&&p->type==INSTRUCTION){
+      if(pass==1&&(p->flags&CACHED_SIZE)){
+        /* place the labels by the sizes of the previous run, verify later */
+        size=p->lastsize;
+        done=0;
+      }
+      else if(pass>fastphase&&relax_grow){
+        /* grow mode: atoms may only become larger */
+        sec->flags|=GROW_ONLY|RESOLVE_WARN;
+        if(pass>fastphase+1&&keep_symdeps(&deps[i],sec->pc))
+          size=p->lastsize;
+        else
+          size=size_atom(p,sec,&deps[i],1);
+        sec->flags&=~RESOLVE_WARN;
+      }
+      else if(pass>fastphase&&!done&&p->type==INSTRUCTION){
         /* entered safe mode: optimize only one instruction every pass */
         sec->pc+=p->lastsize;
         continue;
       }
-      if(p->changes>MAXSIZECHANGES){
+      else if(p->changes>MAXSIZECHANGES){
         /* atom changed size too frequently, set warning flag */
         if(debug)
           printf("setting resolve-warning flag for atom type %d at %lu\n",
                  p->type,(unsigned long)sec->pc);
         sec->flags|=RESOLVE_WARN;
-        size=atom_size(p,sec,sec->pc);
+        size=size_atom(p,sec,&deps[i],0);
         sec->flags&=~RESOLVE_WARN;
       }
+      else if(keep_symdeps(&deps[i],sec->pc))
+        size=p->lastsize;  /* nothing it depends on has changed */
       else
-        size=atom_size(p,sec,sec->pc);
+        size=size_atom(p,sec,&deps[i],track);
       if(size!=p->lastsize){
         if(debug)
           printf("modify size of atom type %d at %lu from %lu to %lu\n",
                  p->type,(unsigned long)sec->pc,(unsigned long)p->lastsize,
                  (unsigned long)size);
         done=0;
-        if(pass>fastphase)
+        resized++;
+        if(pass>fastphase){
           p->changes++;  /* now count size modifications of atoms */
+          if(relax_grow)
+            sec->grown+=(taddr)size-(taddr)p->lastsize;
+        }
         else if(size>p->lastsize)
           extrapass=0;   /* no extra pass, when an atom became larger */
         p->lastsize=size;
       }
       sec->pc+=size;
+      if(p==anchors[a].atom){
+        delta=sec->pc-anchors[a].outpc;
+        anchors[a++].outpc=sec->pc;
+        if(pass>fastphase&&!done&&!relax_grow&&next!=anchors[a].atom&&
+           fixalign!=0&&delta%fixalign==0){
+          /* skip the fixed size atoms up to the next anchor */
+          next=anchors[a].atom;
+          nexti=anchors[a].idx;
+          sec->pc=anchors[a].inpc+delta;
+          while(spans[s].idx<nexti)
+            s++;
+        }
+      }
     }
+    if(pass==1)
+      anchors[nanchors].idx=i;  /* end of section */
+    anchors[a].inpc=sec->pc;
     if(rorg_pc!=0){
       sec->pc=org_pc+(sec->pc-rorg_pc);
       sec->flags&=~ABSOLUTE;  /* workaround for misssing RORGEND */
     }
+    if(st){
+      st->pass=need_room(st->pass,&maxpstats,pass,sizeof(passstat));
+      st->pass[pass-1].fast=pass<=fastphase;
+      st->pass[pass-1].resized=resized;
+      st->pass[pass-1].moved=moved;
+      st->pass[pass-1].time=clock()-t0;
+      st->passes=pass;
+      if(pass<=fastphase)
+        st->fastpasses++;
+    }
     /* Extend the fast-optimization phase, when there was no atom which
        became larger than in the previous pass. */
     if(extrapass) fastphase++;
   }while(errors==0&&!done);
+  if(st)
+    find_top_atoms(st);
+  for(i=nxsecdeps;i>0&&xsecdeps[i-1].sec==sec;i--)
+    xsecdeps[i-1].sym->flags&=~XSECDEP;
+  depsec=NULL;
+  myfree(spans);
+  myfree(anchors);
+  myfree(deps);
+}
+
+static section *moved_xsecdeps(void)
+/* first section, which depends on a label of another one that has moved */
+{
+  section *sec;
+  size_t i;
+
+  for(sec=first_section;sec;sec=sec->next){
+    for(i=0;i<nxsecdeps;i++){
+      if(xsecdeps[i].sec==sec&&xsecdeps[i].sym->pc!=xsecdeps[i].pc){
+        if(debug)
+          printf("label %s of section %s has moved\n",xsecdeps[i].sym->name,
+                 xsecdeps[i].sym->sec->name);
+        return sec;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* The resolve cache keeps the final atom sizes of the previous run. An atom
+   is identified by the contents of its source text, its line and its
+   position within that line. Repeated lines, from macros or repeat-blocks,
+   get the following key of the first free one. Loaded sizes are only a
+   first guess for the resolver, which still has to confirm them. The
+   backends' per-instruction state is not restored, so the resolver may
+   end with different sizes than an assembly without the cache. */
+#define CACHE_ID "vasm resolve cache"
+typedef struct cachent {
+  uint64_t key;         /* 0 is a free slot */
+  size_t size;
+} cachent;
+
+static uint64_t mix_key(uint64_t h)
+{
+  h^=h>>33;
+  h*=0xff51afd7ed558ccdULL;
+  h^=h>>33;
+  h*=0xc4ceb9fe1a85ec53ULL;
+  h^=h>>33;
+  return h?h:1;
+}
+
+static uint64_t source_hash(source *src)
+{
+  if(src->hash==0){
+    uint64_t h=0xcbf29ce484222325ULL;
+    size_t i;
+    for(i=0;i<src->size;i++){
+      h^=(unsigned char)src->text[i];
+      h*=0x100000001b3ULL;
+    }
+    src->hash=mix_key(h^src->size);
+  }
+  return src->hash;
+}
+
+static size_t cache_slot(cachent *tab,size_t mask,uint64_t key)
+{
+  size_t i=(size_t)key&mask;
+
+  while(tab[i].key!=0&&tab[i].key!=key)
+    i=(i+1)&mask;
+  return i;
+}
+
+static size_t cache_mask(size_t n)
+{
+  size_t size=0x100;
+
+  while(size<2*n)
+    size<<=1;
+  return size-1;
+}
+
+static uint64_t *atom_keys(size_t *cnt)
+/* make a unique key for every atom, in the order of the sections */
+{
+  section *sec;
+  atom *p;
+  source *src=NULL;
+  cachent *seen;
+  uint64_t h=0,key,*keys;
+  size_t n=0,mask,i;
+  int line=0;
+  unsigned ord=0;
+
+  for(sec=first_section;sec;sec=sec->next){
+    for(p=sec->first;p;p=p->next)
+      n++;
+  }
+  keys=mymalloc((n?n:1)*sizeof(uint64_t));
+  mask=cache_mask(n);
+  seen=mycalloc((mask+1)*sizeof(cachent));
+  n=0;
+  for(sec=first_section;sec;sec=sec->next){
+    for(p=sec->first;p;p=p->next){
+      if(p->src!=src||p->line!=line){
+        src=p->src;
+        line=p->line;
+        h=src?source_hash(src):0;
+        ord=0;
+      }
+      key=mix_key(h^(((uint64_t)line<<16)+ord++));
+      while(seen[i=cache_slot(seen,mask,key)].key!=0)
+        key=mix_key(key);
+      seen[i].key=key;
+      keys[n++]=key;
+    }
+  }
+  myfree(seen);
+  *cnt=n;
+  return keys;
+}
+
+static void load_cache(void)
+/* initialize the atom sizes from the resolve cache */
+{
+  FILE *f;
+  char id[128],buf[128];
+  cachent *tab;
+  section *sec;
+  atom *p;
+  uint64_t *keys;
+  unsigned long long key;
+  unsigned long entries,size;
+  size_t n,cnt,mask,i;
+
+  if(!(f=fopen(cachename,"r")))
+    return;  /* first run */
+  snprintf(id,sizeof(id),"%s %s %s\n",CACHE_ID,cpuname,output_format);
+  if(!fgets(buf,sizeof(buf),f)||strcmp(buf,id)||
+     fscanf(f,"%lu",&entries)!=1){
+    fclose(f);
+    return;  /* for another target */
+  }
+  mask=cache_mask(entries);
+  tab=mycalloc((mask+1)*sizeof(cachent));
+  for(n=0;n<entries&&fscanf(f,"%llx %lu",&key,&size)==2;n++){
+    if(key==0)
+      continue;
+    i=cache_slot(tab,mask,key);
+    tab[i].key=key;
+    tab[i].size=size;
+  }
+  fclose(f);
+  keys=atom_keys(&cnt);
+  for(n=0,sec=first_section;sec;sec=sec->next){
+    for(p=sec->first;p;p=p->next){
+      i=cache_slot(tab,mask,keys[n++]);
+      if(tab[i].key!=0&&!(p->flags&STABLE_SIZE)){
+        p->lastsize=tab[i].size;
+        p->flags|=CACHED_SIZE;
+      }
+    }
+  }
+  myfree(keys);
+  myfree(tab);
+}
+
+static void save_cache(void)
+/* write the final atom sizes into the resolve cache */
+{
+  FILE *f;
+  section *sec;
+  atom *p;
+  uint64_t *keys;
+  size_t n,cnt;
+
+  if(!(f=fopen(cachename,"w"))){
+    general_error(74,cachename);
+    return;
+  }
+  keys=atom_keys(&cnt);
+  fprintf(f,"%s %s %s\n%lu\n",CACHE_ID,cpuname,output_format,
+          (unsigned long)cnt);
+  for(n=0,sec=first_section;sec;sec=sec->next){
+    for(p=sec->first;p;p=p->next,n++)
+      fprintf(f,"%llx %lu\n",(unsigned long long)keys[n],
+              (unsigned long)p->lastsize);
+  }
+  myfree(keys);
+  if(fclose(f))
+    general_error(74,cachename);
 }
 
 static void resolve(void)
 {
   section *sec;
+  int n;
   final_pass=0;
   if(debug)
     printf("resolve()\n");
   for(sec=first_section;sec;sec=sec->next)
     resolve_section(sec);
+  /* A section may depend on labels of sections, which were resolved later.
+     Repeat until no section depends on a moved label. */
+  for(n=1;errors==0&&(sec=moved_xsecdeps())!=NULL;n++){
+    if(n>=MAXPASSES){
+      general_error(7,sec->name);
+      break;
+    }
+    resolve_section(sec);
+  }
+  myfree(xsecdeps);
+  xsecdeps=NULL;
+  nxsecdeps=maxxsecdeps=0;
+}
+
+static void free_relocs(rlist *rl)
+{
+  rlist *next;
+
+  for(;rl;rl=next){
+    next=rl->next;
+    myfree(rl->reloc);
+    myfree(rl);
+  }
+}
+
+static void free_atoms(section *sec)
+/* release the atoms of a section, which has already been written;
+   texts, print expressions and assertion messages may be shared or
+   static, and OPTS belong to the cpu backend, so these are kept */
+{
+  atom *p,*next;
+
+  for(p=sec->first;p;p=next){
+    next=p->next;
+    switch(p->type){
+      case DATA:
+        free_relocs(p->content.db->relocs);
+        myfree(p->content.db->data);
+        myfree(p->content.db);
+        break;
+      case SPACE:
+        free_relocs(p->content.sb->relocs);
+        free_expr(p->content.sb->space_exp);
+        free_expr(p->content.sb->fill_exp);
+        myfree(p->content.sb);
+        break;
+      case PRINTEXPR:
+        myfree(p->content.pexpr);
+        break;
+      case ASSERT:
+        free_expr(p->content.assert->assert_exp);
+        myfree(p->content.assert);
+        break;
+      case NLIST:
+        /* the name is still used by its stabdef */
+        free_expr(p->content.nlist->value);
+        myfree(p->content.nlist);
+        break;
+      case RORG:
+        myfree(p->content.rorg);
+        break;
+    }
+    myfree(p);
+  }
+  sec->first=sec->last=NULL;
 }
 
 static void assemble(void)
@@ -303,7 +1082,7 @@ static void assemble(void)
         p->list->sec=sec;
         p->list->pc=sec->pc;
       }
-      if(p->changes>MAXSIZECHANGES)
+      if(p->changes>MAXSIZECHANGES||(sec->flags&GROW_ONLY))
         sec->flags|=RESOLVE_WARN;
       /* print a warning on auto-aligned instructions or data */
       if(sec->pc!=basepc){
@@ -419,6 +1198,10 @@ static void assemble(void)
       rorg_pc=0;
       sec->flags&=~ABSOLUTE;
     }
+    if(streaming&&!(sec->flags&UNALLOCATED)){
+      stream_section(outfile,sec);
+      free_atoms(sec);
+    }
   }
   remove_unalloc_sects();
 }
@@ -474,8 +1257,11 @@ static void statistics(void)
   printf("\n");
   for(sec=first_section;sec;sec=sec->next){
     size=ULLTADDR(ULLTADDR(sec->pc)-ULLTADDR(sec->org));
-    printf("%s(%s%lu):\t%12llu byte%c\n",sec->name,sec->attr,
+    printf("%s(%s%lu):\t%12llu byte%c",sec->name,sec->attr,
            (unsigned long)sec->align,size,size==1?' ':'s');
+    if(sec->grown)
+      printf(" (%+ld after fast phase)",(long)sec->grown);
+    printf("\n");
   }
 }
 
@@ -506,24 +1292,68 @@ static int init_output(char *fmt)
   return 0;
 }
 
+/* returns the index of the first mnemonic with this name, or -1 */
+int find_mnemonic(char *name,int len,int no_case)
+{
+  if(mnemohash){
+    hashdata data;
+    if(no_case?find_namelen_nc(mnemohash,name,len,&data):
+               find_namelen(mnemohash,name,len,&data))
+      return data.idx;
+  }else{
+    uint64_t h=phash_code(name,len);
+    uint32_t d=mnemo_phash_disp[PHASH_BUCKET(h,mnemo_phash_nbuckets)];
+    int idx=mnemo_phash_idx[phash_slot(h,d,mnemo_phash_size-1)];
+    if(idx>=0&&!(no_case?strnicmp:strncmp)(mnemonics[idx].name,name,len)&&
+       mnemonics[idx].name[len]==0&&!(mnemo_removed&&mnemo_removed[idx]))
+      return idx;
+  }
+  return -1;
+}
+
+/* remove a mnemonic name, which is no longer recognized */
+void rem_mnemonic(char *name)
+{
+  int idx;
+  if(mnemohash)
+    rem_hashentry(mnemohash,name,0);
+  else if((idx=find_mnemonic(name,strlen(name),0))>=0){
+    if(!mnemo_removed)
+      mnemo_removed=mycalloc(mnemonic_cnt);
+    mnemo_removed[idx]=1;
+  }else
+    ierror(0);
+}
+
 static int init_main(void)
 {
   size_t i;
   char *last;
   hashdata data;
-  mnemohash=new_hashtable(MNEMOHTABSIZE);
-  i=0;
-  while(i<mnemonic_cnt){
-    data.idx=i;
-    last=mnemonics[i].name;
-    add_hashentry(mnemohash,mnemonics[i].name,data);
-    do{
-      i++;
-    }while(i<mnemonic_cnt&&!strcmp(last,mnemonics[i].name));
-  }
-  if(debug){
-    if(mnemohash->collisions)
-      printf("*** %d mnemonic collisions!!\n",mnemohash->collisions);
+  if(mnemo_phash_cnt!=mnemonic_cnt){
+    /* no usable table from mkphash, build the hash table now */
+    mnemohash=new_hashtable(mnemonic_cnt);
+    i=0;
+    while(i<mnemonic_cnt){
+      data.idx=i;
+      last=mnemonics[i].name;
+      add_hashentry(mnemohash,mnemonics[i].name,data);
+      do{
+        i++;
+      }while(i<mnemonic_cnt&&!strcmp(last,mnemonics[i].name));
+    }
+    if(debug)
+      print_hashstats(stdout,mnemohash,"mnemonic");
+  }else if(debug){
+    /* verify the generated table */
+    for(i=0;i<mnemonic_cnt;i++){
+      int idx=find_mnemonic(mnemonics[i].name,strlen(mnemonics[i].name),0);
+      if(idx<0||(idx>0&&!strcmp(mnemonics[idx-1].name,mnemonics[i].name)))
+        ierror(0);
+    }
+    printf("mnemonic perfect hash: %d entries, %lu buckets, size %lu\n",
+           mnemonic_cnt,(unsigned long)mnemo_phash_nbuckets,
+           (unsigned long)mnemo_phash_size);
   }
   new_include_path(".");
   taddrmask=MAKEMASK(bytespertaddr<<3);
@@ -741,6 +1571,30 @@ int main(int argc,char **argv)
       chklabels=1;
       continue;
     }
+    else if(!strcmp("-relax=grow",argv[i])){
+      relax_grow=1;
+      continue;
+    }
+    else if(!strcmp("-relax=safe",argv[i])){
+      relax_grow=0;
+      continue;
+    }
+    else if(!strcmp("-stream",argv[i])){
+      stream_output=1;
+      continue;
+    }
+    else if(!strcmp("-resolve-stats",argv[i])){
+      resolve_stats=1;
+      continue;
+    }
+    else if(!strcmp("-resolve-stats=json",argv[i])){
+      resolve_stats=2;
+      continue;
+    }
+    else if(!strncmp("-resolve-cache=",argv[i],15)){
+      cachename=argv[i]+15;
+      continue;
+    }
     else if(!strcmp("-noialign",argv[i])) {
       inst_alignment=1;
       continue;
@@ -774,10 +1628,29 @@ int main(int argc,char **argv)
   if(!init_cpu())
     general_error(10,"cpu");
   parse();
+  if(cachename&&errors==0)
+    load_cache();
+  memo_exprs(1);
   if(errors==0||produce_listing)
     resolve();
+  if(resolve_stats)
+    print_resolve_stats();
+  if(stream_output&&start_stream&&errors==0&&
+     !produce_listing&&!depend&&!debug&&!cachename){
+    /* write each section right after assembling it */
+    if(!outname)
+      outname="a.out";
+    if(!(outfile=fopen(outname,"wb")))
+      general_error(13,outname);
+    streaming=start_stream(outfile,first_section,first_symbol);
+  }
   if(errors==0||produce_listing)
     assemble();
+  memo_exprs(0);
+  if(streaming)
+    stream_section(outfile,NULL);
+  if(cachename&&errors==0)
+    save_cache();
   cur_src=NULL;
   if(errors==0)
     undef_syms();
@@ -793,11 +1666,15 @@ int main(int argc,char **argv)
         statistics();
       if(!outname)
         outname="a.out";
-      outfile=fopen(outname,"wb");
+      if(!outfile)
+        outfile=fopen(outname,"wb");
       if(!outfile)
         general_error(13,outname);
-      else
-        write_object(outfile,first_section,first_symbol);
+      else if(!streaming){
+        exportidx *x=build_exportidx(first_symbol);
+        write_object(outfile,first_section,first_symbol,x);
+        free_exportidx(x);
+      }
     }else
       write_depends(stdout);
   }
@@ -967,9 +1844,10 @@ source *new_source(char *filename,char *text,size_t size)
 
   s->parent = cur_src;
   s->parent_line = cur_src ? cur_src->line : 0;
-  s->name = mystrdup(filename);
+  s->name = intern_name(filename);
   s->text = text;
   s->size = size;
+  s->hash = 0;
   s->macro = NULL;
   s->repeat = 1;        /* read just once */
   s->irpname = NULL;
@@ -1032,11 +1910,12 @@ section *new_section(char *name,char *attr,int align)
     return p;
   p=mymalloc(sizeof(*p));
   p->next=0;
-  p->name=mystrdup(name);
-  p->attr=mystrdup(attr);
+  p->name=intern_name(name);
+  p->attr=intern_name(attr);
   p->first=p->last=0;
   p->align=align;
   p->org=p->pc=0;
+  p->grown=0;
   p->flags=0;
   p->memattr=0;
   memset(p->pad,0,MAXPADBYTES);
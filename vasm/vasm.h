@@ -75,6 +75,7 @@ struct source {
   char *name;
   char *text;
   size_t size;
+  uint64_t hash;        /* of the text, 0 until needed */
   macro *macro;
   unsigned long repeat;
   char *irpname;
@@ -111,6 +112,7 @@ struct source {
 #define PREVABS 32          /* saved ABSOLUTE-flag during RORG-block */
 #define IN_RORG 64
 #define NEAR_ADDRESSING 128
+#define GROW_ONLY 256       /* sizes were resolved by -relax=grow */
 #define SECRSRVD (1L<<24)   /* bits 24..31 are reserved for output modules */
 
 /* section description */
@@ -127,6 +129,7 @@ struct section {
   uint32_t memattr;  /* type of memory, used by some object formats */
   taddr org;
   taddr pc;
+  taddr grown;       /* bytes added by -relax=grow */
   unsigned long idx; /* usable by output module */
 };
 
@@ -161,13 +164,12 @@ struct listing {
 
 
 extern listing *first_listing,*last_listing,*cur_listing;
-extern int done,final_pass;
+extern int done,final_pass,record_symdeps;
 extern int warn_unalloc_ini_dat;
 extern int listena,listformfeed,listlinesperpage,listnosyms;
 extern int mnemonic_cnt;
 extern int nocase,no_symbols,pic_check,secname_attr,exec_out,chklabels;
 extern taddr inst_alignment;
-extern hashtable *mnemohash;
 extern source *cur_src;
 extern section *current_section;
 extern char *filename;
@@ -184,7 +186,11 @@ extern unsigned long long taddrmask;
 extern int debug;
 
 void leave(void);
+void add_symdep(symbol *);
+void add_symrange(symbol *,taddr,taddr,taddr,int);
 void set_default_output_format(char *);
+int find_mnemonic(char *,int,int);
+void rem_mnemonic(char *);
 FILE *locate_file(char *,char *);
 void include_source(char *);
 source *new_source(char *,char *,size_t);
@@ -242,6 +248,9 @@ void init_instruction_ext(instruction_ext *);
 char *parse_instruction(char *,int *,char **,int *,int *);
 int set_default_qualifiers(char **,int *);
 #endif
+#if HAVE_INSTRUCTION_FINAL
+int instruction_final(instruction *);
+#endif
 #if HAVE_CPU_OPTS
 void cpu_opts_init(section *);
 void cpu_opts(void *);
@@ -275,11 +284,15 @@ extern int tos_hisoft_dri;
 extern int hunk_onlyglobal;
 #endif
 
-int init_output_test(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
-int init_output_elf(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
-int init_output_bin(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
-int init_output_srec(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
-int init_output_vobj(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
-int init_output_hunk(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
-int init_output_aout(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
-int init_output_tos(char **,void (**)(FILE *,section *,symbol *),int (**)(char *));
+/* optional, for output formats which can be written section by section */
+extern int (*start_stream)(FILE *,section *,symbol *);
+extern void (*stream_section)(FILE *,section *);
+
+int init_output_test(char **,void (**)(FILE *,section *,symbol *,exportidx *),int (**)(char *));
+int init_output_elf(char **,void (**)(FILE *,section *,symbol *,exportidx *),int (**)(char *));
+int init_output_bin(char **,void (**)(FILE *,section *,symbol *,exportidx *),int (**)(char *));
+int init_output_srec(char **,void (**)(FILE *,section *,symbol *,exportidx *),int (**)(char *));
+int init_output_vobj(char **,void (**)(FILE *,section *,symbol *,exportidx *),int (**)(char *));
+int init_output_hunk(char **,void (**)(FILE *,section *,symbol *,exportidx *),int (**)(char *));
+int init_output_aout(char **,void (**)(FILE *,section *,symbol *,exportidx *),int (**)(char *));
+int init_output_tos(char **,void (**)(FILE *,section *,symbol *,exportidx *),int (**)(char *));